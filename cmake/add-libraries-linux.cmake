@@ -6,4 +6,14 @@ include_directories("${CMAKE_SOURCE_DIR}/3rd_party/opencv/include")
 link_directories("${CMAKE_SOURCE_DIR}/3rd_party/glad/lib/linux")
 link_directories("${CMAKE_SOURCE_DIR}/3rd_party/glfw3/lib/linux")
 link_directories("${CMAKE_SOURCE_DIR}/3rd_party/freeimage/lib/linux")
-link_directories("${CMAKE_SOURCE_DIR}/3rd_party/opencv/lib/linux")
\ No newline at end of file
+link_directories("${CMAKE_SOURCE_DIR}/3rd_party/opencv/lib/linux")
+
+if(USE_FFMPEG)
+   include_directories("${CMAKE_SOURCE_DIR}/3rd_party/ffmpeg/include")
+   link_directories("${CMAKE_SOURCE_DIR}/3rd_party/ffmpeg/lib/linux")
+endif()
+
+if(USE_LZ4)
+   include_directories("${CMAKE_SOURCE_DIR}/3rd_party/lz4/include")
+   link_directories("${CMAKE_SOURCE_DIR}/3rd_party/lz4/lib/linux")
+endif()
\ No newline at end of file
@@ -12,4 +12,14 @@ if(${CMAKE_BUILD_TYPE} MATCHES Debug)
 else()
     link_directories("${CMAKE_SOURCE_DIR}/3rd_party/freeimage/lib/windows/release")
     link_directories("${CMAKE_SOURCE_DIR}/3rd_party/opencv/lib/windows/release")
+endif()
+
+if(USE_FFMPEG)
+   include_directories("${CMAKE_SOURCE_DIR}/3rd_party/ffmpeg/include")
+   link_directories("${CMAKE_SOURCE_DIR}/3rd_party/ffmpeg/lib/windows")
+endif()
+
+if(USE_LZ4)
+   include_directories("${CMAKE_SOURCE_DIR}/3rd_party/lz4/include")
+   link_directories("${CMAKE_SOURCE_DIR}/3rd_party/lz4/lib/windows")
 endif()
\ No newline at end of file
@@ -1,13 +1,24 @@
-target_link_libraries(
-     CubeMapping
-        glad
-        glfw3
-        pthread
-        dl
-        X11
-        freeimage
-        opencv_core
-        opencv_imgproc
-        opencv_imgcodecs
-        opencv_videoio
-)
\ No newline at end of file
+foreach(target ${APPLICATION_TARGETS})
+   target_link_libraries(
+        ${target}
+           glad
+           glfw3
+           pthread
+           rt
+           dl
+           X11
+           freeimage
+           opencv_core
+           opencv_imgproc
+           opencv_imgcodecs
+           opencv_videoio
+   )
+
+   if(USE_FFMPEG)
+      target_link_libraries(${target} avformat avcodec swscale avutil)
+   endif()
+
+   if(USE_LZ4)
+      target_link_libraries(${target} lz4)
+   endif()
+endforeach()
\ No newline at end of file
@@ -1,7 +1,17 @@
-target_link_libraries(CubeMapping glad glfw3dll)
+foreach(target ${APPLICATION_TARGETS})
+   target_link_libraries(${target} glad glfw3dll)
 
-if(${CMAKE_BUILD_TYPE} MATCHES Debug)
-   target_link_libraries(CubeMapping FreeImaged opencv_cored opencv_imgprocd opencv_imgcodecsd opencv_videoiod)
-else()
-   target_link_libraries(CubeMapping FreeImage opencv_core opencv_imgproc opencv_imgcodecs opencv_videoio)
-endif()
\ No newline at end of file
+   if(${CMAKE_BUILD_TYPE} MATCHES Debug)
+      target_link_libraries(${target} FreeImaged opencv_cored opencv_imgprocd opencv_imgcodecsd opencv_videoiod)
+   else()
+      target_link_libraries(${target} FreeImage opencv_core opencv_imgproc opencv_imgcodecs opencv_videoio)
+   endif()
+
+   if(USE_FFMPEG)
+      target_link_libraries(${target} avformat avcodec swscale avutil)
+   endif()
+
+   if(USE_LZ4)
+      target_link_libraries(${target} lz4)
+   endif()
+endforeach()
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "_Common.h"
+
+// S3TC is an extension rather than core OpenGL, but every desktop driver exposes it.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum class BlockFormat { None = 0, BC1, BC3, BC7 };
+
+// Compresses BGR or BGRA images into 4 x 4 blocks for compressed textures, at a speed meant for video frames.
+// BC1 keeps RGB in 8 bytes per block, BC3 adds 8 bytes of alpha to it, and BC7 keeps RGB in 16 bytes with mode 6
+// only, which is its fast single-subset mode. The endpoints span the bounding box of a block along the diagonal its
+// pixels follow, and the pixels are projected onto them. The blocks of an image are kept in a single-channel image
+// with a row of blocks per row.
+class BlockCompressor
+{
+public:
+   [[nodiscard]] static int getBlockBytes(BlockFormat format) { return format == BlockFormat::BC1 ? 8 : 16; }
+   [[nodiscard]] static GLenum getInternalFormat(BlockFormat format)
+   {
+      switch (format) {
+         case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+         case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+         default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+      }
+   }
+   [[nodiscard]] static const char* getFormatName(BlockFormat format)
+   {
+      return format == BlockFormat::BC1 ? "BC1" : format == BlockFormat::BC3 ? "BC3" : "BC7";
+   }
+   [[nodiscard]] static bool isCompressible(const cv::Size& size)
+   {
+      return size.width > 0 && size.height > 0 && size.width % 4 == 0 && size.height % 4 == 0;
+   }
+   [[nodiscard]] static cv::Size getBlockImageSize(const cv::Size& size, BlockFormat format)
+   {
+      return { size.width / 4 * getBlockBytes( format ), size.height / 4 };
+   }
+   // The rows of blocks are split across threads. Only BC3 keeps the alpha of BGRA images, which is 255 for BGR ones.
+   static void compress(const cv::Mat& image, BlockFormat format, cv::Mat& blocks);
+   // Only the blocks written by compress are decoded, which is all the benchmark needs to measure the quality.
+   // The alpha of BC3 blocks is left out.
+   static void decompress(const cv::Mat& blocks, BlockFormat format, const cv::Size& size, cv::Mat& bgr);
+
+private:
+   using BlockPixels = std::array<std::array<int, 3>, 16>; // RGB
+
+   static void getDiagonalEndpoints(const BlockPixels& pixels, std::array<int, 3>& first, std::array<int, 3>& last);
+   static void getIndices(
+      const BlockPixels& pixels,
+      const std::array<int, 3>& first,
+      const std::array<int, 3>& last,
+      int level_num,
+      std::array<int, 16>& indices
+   );
+   static void compressBC1Block(const BlockPixels& pixels, uint8_t* block);
+   static void compressAlphaBlock(const std::array<int, 16>& alphas, uint8_t* block);
+   static void compressBC7Block(const BlockPixels& pixels, uint8_t* block);
+   static void decompressBC1Block(const uint8_t* block, BlockPixels& pixels);
+   static void decompressBC7Block(const uint8_t* block, BlockPixels& pixels);
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "VideoSource.h"
+#include "FrameStore.h"
+
+// Records the frames of the first complete play into a frame store, and plays the store instead of decoding
+// the video afterwards until the video changes. The streams of a cube record at once, so each of them gets its share
+// of the size limit, and a recording stops once the directory would go over the limit.
+class CachedVideoSource final : public VideoSource
+{
+public:
+   CachedVideoSource(
+      std::unique_ptr<VideoSource> decoder,
+      std::string cache_directory,
+      int64_t cache_size_limit,
+      int cache_share_num
+   );
+   ~CachedVideoSource() override;
+
+   bool open(const std::string& video_path, PixelFormat pixel_format) override;
+   void close() override;
+   bool read(cv::Mat& image) override;
+   bool skip() override;
+   bool seek(int64_t frame_index) override;
+   bool getKeyframes(std::vector<int64_t>& keyframes) override;
+   [[nodiscard]] bool isOpened() const override { return Cached || Decoder->isOpened(); }
+   [[nodiscard]] double getFPS() const override { return Cached ? Store.getFPS() : Decoder->getFPS(); }
+   [[nodiscard]] cv::Size getFrameSize() const override;
+   [[nodiscard]] double getTimestamp() const override { return Cached ? Timestamp : Decoder->getTimestamp(); }
+   [[nodiscard]] StageTimes getStageTimes() const override;
+   [[nodiscard]] bool isCached() const { return Cached; }
+
+private:
+   const std::string CacheDirectory;
+   const int64_t CacheSizeLimit;
+   const int64_t StoreSizeLimit;
+   const int64_t DirectoryCheckInterval; // bytes written between checks of the whole directory
+   int64_t NextDirectoryCheck;
+   bool Cached;
+   bool Recording;
+   PixelFormat Format;
+   int64_t NextFrameIndex;
+   double Timestamp;
+   std::string StorePath;
+   cv::Mat SkippedImage;
+   FrameStore Store;
+   std::unique_ptr<VideoSource> Decoder;
+
+   void stopRecording(bool complete);
+   // Whether the store can take the image without going over its share or the directory over the whole limit
+   [[nodiscard]] bool fitsSizeLimit(const cv::Mat& image);
+};
\ No newline at end of file
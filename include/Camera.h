@@ -16,11 +16,20 @@ public:
    );
 
    [[nodiscard]] bool getMovingState() const { return IsMoving; }
+   [[nodiscard]] int getWidth() const { return Width; }
+   [[nodiscard]] int getHeight() const { return Height; }
+   [[nodiscard]] float getFOV() const { return FOV; }
    [[nodiscard]] glm::vec3 getCameraPosition() const { return CamPos; }
    [[nodiscard]] const glm::mat4& getViewMatrix() const { return ViewMatrix; }
    [[nodiscard]] const glm::mat4& getProjectionMatrix() const { return ProjectionMatrix; }
    void setMovingState(bool is_moving) { IsMoving = is_moving; }
    void updateCamera();
+   void setView(
+      const glm::vec3& cam_position,
+      const glm::vec3& view_reference_position,
+      const glm::vec3& view_up_vector
+   );
+   void setFOV(float fov);
    void pitch(int angle);
    void yaw(int angle);
    void rotateAroundWorldY(int angle);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Camera.h"
+
+// Camera keyframes for offline rendering, read from a text file with one keyframe per line:
+//   <time in ms> <position x y z> <reference x y z> <fov>
+// The lines starting with # are ignored. Between keyframes, the pose and the field of view are interpolated linearly.
+class CameraPath
+{
+public:
+   struct Keyframe
+   {
+      double Time;
+      glm::vec3 Position;
+      glm::vec3 Reference;
+      float FOV;
+   };
+
+   CameraPath() = default;
+
+   bool load(const std::string& path);
+   void apply(CameraGL* camera, double time) const;
+   [[nodiscard]] bool empty() const { return Keyframes.empty(); }
+   [[nodiscard]] double getDuration() const { return Keyframes.empty() ? 0.0 : Keyframes.back().Time; }
+
+private:
+   std::vector<Keyframe> Keyframes;
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CubeFaceRemap.h"
+
+// Turns the frames of a video in another projection into a cube atlas, so that a single video covers the cube.
+// A dual-fisheye video is calibrated by a <video>.fisheye sidecar with one line per lens:
+//   <center x> <center y> <radius> <fov> <yaw> <pitch> <roll>
+// in pixels and degrees, where a lens with no rotation looks along +z with +y up, and the model is equidistant.
+// A packed video already holds the faces, so they are only rearranged, or decoded in place when they are in order.
+// The equi-angular remap of the faces is left to the shader.
+class CubeAtlasVideoSource final : public VideoSource
+{
+public:
+   CubeAtlasVideoSource(std::unique_ptr<VideoSource> decoder, const Settings& settings);
+   ~CubeAtlasVideoSource() override = default;
+
+   bool open(const std::string& video_path, PixelFormat pixel_format) override;
+   void close() override { Decoder->close(); }
+   bool read(cv::Mat& image) override;
+   bool skip() override { return Decoder->skip(); }
+   bool seek(int64_t frame_index) override { return Decoder->seek( frame_index ); }
+   bool getKeyframes(std::vector<int64_t>& keyframes) override { return Decoder->getKeyframes( keyframes ); }
+   [[nodiscard]] bool isOpened() const override { return Decoder->isOpened(); }
+   [[nodiscard]] double getFPS() const override { return Decoder->getFPS(); }
+   [[nodiscard]] cv::Size getFrameSize() const override { return CubeFaceRemap::getAtlasSize( FaceSize ); }
+   [[nodiscard]] double getTimestamp() const override { return Decoder->getTimestamp(); }
+   [[nodiscard]] StageTimes getStageTimes() const override;
+
+private:
+   struct FisheyeLens
+   {
+      glm::vec2 Center;
+      float Radius;
+      float HalfFOV; // radians
+      glm::mat3 Rotation;
+   };
+
+   const Projection InputProjection;
+   const int RequestedFaceSize;
+   std::string FaceOrder;
+   std::string FaceRotation;
+   PixelFormat Format;
+   int FaceSize;
+   bool Resampled; // false when the decoded frames are packed faces
+   bool Rearranged;
+   std::array<int, 6> PackedFaces; // the face at each place of the packed layout
+   std::array<int, 6> PackedQuarterTurns;
+   cv::Mat SourceImage;
+   CubeFaceRemap Remap;
+   std::unique_ptr<VideoSource> Decoder;
+
+   [[nodiscard]] static bool loadFisheyeLenses(const std::string& video_path, std::array<FisheyeLens, 2>& lenses);
+   bool preparePacking(const std::string& video_path);
+   void rearrangeFaces(const cv::Mat& source, cv::Mat& atlas) const;
+   [[nodiscard]] static bool projectToFisheye(
+      const std::array<FisheyeLens, 2>& lenses,
+      const glm::vec3& direction,
+      glm::vec2& position
+   );
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "MappedFile.h"
+
+// Decodes the face images of a cube on a few threads and hands them over in the order they finish, so that the faces
+// decoded first can be uploaded while the others are still decoding.
+class CubeFaceLoader
+{
+public:
+   struct FaceTimes
+   {
+      double Decode; // ms the face took to decode
+      double Ready;  // ms from the start until the face was decoded
+
+      FaceTimes() : Decode( 0.0 ), Ready( 0.0 ) {}
+   };
+
+   CubeFaceLoader();
+   ~CubeFaceLoader();
+
+   CubeFaceLoader(const CubeFaceLoader&) = delete;
+   CubeFaceLoader& operator=(const CubeFaceLoader&) = delete;
+
+   // Reads the size of a JPEG image from its frame header without decoding it, or returns an empty size for any
+   // other image.
+   [[nodiscard]] static cv::Size getJPEGSize(const std::string& image_path);
+   void start(const std::vector<std::string>& image_paths, int read_flags = cv::IMREAD_COLOR);
+   // Blocks until another face is decoded, and returns false once every face has been taken.
+   // The image is empty when the face could not be read.
+   bool takeFace(int& face, cv::Mat& image);
+   void stop();
+   [[nodiscard]] int getFaceNum() const { return static_cast<int>(ImagePaths.size()); }
+   [[nodiscard]] const std::string& getImagePath(int face) const { return ImagePaths[face]; }
+   [[nodiscard]] FaceTimes getFaceTimes(int face);
+   [[nodiscard]] double getElapsedTime() const
+   {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+   }
+
+private:
+   int ReadFlags;
+   std::vector<std::string> ImagePaths;
+   std::vector<cv::Mat> Images;
+   std::vector<FaceTimes> Times;
+   std::deque<int> DecodedFaces;
+   int TakenFaceNum;
+   std::atomic<int> NextFace;
+   std::vector<std::thread> Decoders;
+   std::mutex Mutex;
+   std::condition_variable FaceDecoded;
+   std::chrono::steady_clock::time_point StartTime;
+
+   void decode();
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "VideoSource.h"
+
+// Resamples pictures of another projection into a cube atlas, which has the six faces in the order of the cube map
+// faces on two rows of three. The lookup tables are built once, and each picture is then resampled bilinearly.
+class CubeFaceRemap
+{
+public:
+   // Gives the position in the source picture, with the pixel centers on integers, that a direction comes from,
+   // or false if the source does not cover the direction.
+   using Projection = std::function<bool(const glm::vec3& direction, glm::vec2& position)>;
+
+   CubeFaceRemap() : FaceSize( 0 ) {}
+
+   void build(const Projection& projection, int face_size, VideoSource::PixelFormat pixel_format);
+   void apply(const cv::Mat& source, cv::Mat& atlas, VideoSource::PixelFormat pixel_format) const;
+   [[nodiscard]] int getFaceSize() const { return FaceSize; }
+   [[nodiscard]] static cv::Size getAtlasSize(int face_size) { return { face_size * 3, face_size * 2 }; }
+   [[nodiscard]] static cv::Rect getFaceArea(int face, int face_size)
+   {
+      return { face % 3 * face_size, face / 3 * face_size, face_size, face_size };
+   }
+   // The direction through (s, t) of the face, where (0, 0) is the corner of the first texel. It is the inverse of
+   // the face selection in the OpenGL specification, and the tools that only make cube maps use it as well.
+   [[nodiscard]] static glm::vec3 getCubeMapDirection(int face, const glm::vec2& st)
+   {
+      const float sc = 2.0f * st.x - 1.0f;
+      const float tc = 2.0f * st.y - 1.0f;
+      switch (face) {
+         case 0: return { 1.0f, -tc, -sc };
+         case 1: return { -1.0f, -tc, sc };
+         case 2: return { sc, 1.0f, tc };
+         case 3: return { sc, -1.0f, -tc };
+         case 4: return { sc, -tc, 1.0f };
+         default: return { -sc, -tc, -1.0f };
+      }
+   }
+   // Copies the faces out of an atlas into six pictures of the same pixel format.
+   static void splitAtlas(const cv::Mat& atlas, VideoSource::PixelFormat pixel_format, std::vector<cv::Mat>& faces);
+
+private:
+   int FaceSize;
+   std::array<cv::Mat, 2> LumaMaps; // in the fixed-point format of cv::convertMaps
+   std::array<cv::Mat, 2> ChromaMaps;
+
+   static void buildMaps(const Projection& projection, int face_size, float scale, std::array<cv::Mat, 2>& maps);
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "MappedFile.h"
+
+// A cube map in the layout its texture takes: the six faces of every mip level in the GL format they are uploaded
+// with, each on pages of its own after a header and a table of the faces. A file is mapped and its faces are uploaded
+// straight from the mapping. The header records a hash of the images the cube map was made of, so a cached file is
+// only used while they are unchanged.
+class CubeMapFile
+{
+public:
+   static constexpr uint64_t PayloadAlignment = 4096;
+
+   CubeMapFile();
+   ~CubeMapFile() = default;
+
+   CubeMapFile(const CubeMapFile&) = delete;
+   CubeMapFile& operator=(const CubeMapFile&) = delete;
+
+   [[nodiscard]] static uint64_t getContentHash(const std::vector<std::string>& image_paths);
+   [[nodiscard]] static std::string getCachePath(const std::string& directory, uint64_t content_hash);
+   [[nodiscard]] static int getLevelNum(int width, int height);
+   // The faces are written as they are, so they should already be laid out in the format and the type. Compressed
+   // faces are the block images of BlockCompressor, with 0 for the format and the type.
+   static bool write(
+      const std::string& file_path,
+      uint64_t content_hash,
+      GLenum internal_format,
+      GLenum format,
+      GLenum type,
+      const std::vector<std::array<cv::Mat, 6>>& levels
+   );
+   // A content hash of 0 accepts a file made of any images.
+   bool open(const std::string& file_path, uint64_t content_hash = 0);
+   void close();
+   [[nodiscard]] bool isOpened() const { return File.isOpened(); }
+   [[nodiscard]] GLenum getInternalFormat() const { return Header.InternalFormat; }
+   [[nodiscard]] bool isCompressed() const { return Header.Format == 0; }
+   [[nodiscard]] GLenum getFormat() const { return Header.Format; }
+   [[nodiscard]] GLenum getType() const { return Header.Type; }
+   [[nodiscard]] int getLevelNum() const { return static_cast<int>(Header.LevelNum); }
+   [[nodiscard]] cv::Size getFaceSize(int level) const
+   {
+      return { std::max( Header.Width >> level, 1 ), std::max( Header.Height >> level, 1 ) };
+   }
+   [[nodiscard]] const uint8_t* getFaceData(int level, int face) const
+   {
+      return File.getData() + Faces[level * 6 + face].Offset;
+   }
+   [[nodiscard]] size_t getFaceBytes(int level, int face) const { return Faces[level * 6 + face].Size; }
+
+private:
+   struct FileHeader
+   {
+      char Magic[4];
+      uint32_t Version;
+      uint64_t ContentHash;
+      uint32_t InternalFormat;
+      uint32_t Format; // the client format of the faces, or 0 when they are compressed blocks
+      uint32_t Type;
+      int32_t Width, Height;
+      uint32_t LevelNum;
+   };
+
+   struct FaceEntry
+   {
+      uint64_t Offset;
+      uint64_t Size;
+   };
+
+   inline static const std::string Extension = ".cubemap";
+   FileHeader Header;
+   std::vector<FaceEntry> Faces; // the six faces of each level in turn
+   MappedFile File;
+
+   // The bytes a face of the level takes in the internal format of the header, or 0 for a format that is not read
+   [[nodiscard]] uint64_t getExpectedFaceBytes(int level) const;
+};
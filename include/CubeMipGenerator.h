@@ -0,0 +1,35 @@
+#pragma once
+
+#include "_Common.h"
+
+// Makes the mip levels of a cube on the CPU. Each level averages 2 x 2 texels of the level above, with SSE2 or AVX2
+// for BGRA faces. The texels along the edges of a face are then averaged with the ones they meet on the neighboring
+// faces, so that a minified cube shows no seams where the faces were halved apart.
+class CubeMipGenerator
+{
+public:
+   // Adds the levels below the first one until the faces are 1 x 1. The faces have to be 8-bit images of one size.
+   static void addMipLevels(std::vector<std::array<cv::Mat, 6>>& levels);
+   static void downsample(const cv::Mat& image, cv::Mat& half);
+
+private:
+   // Returns how many texels of the halved row were made, which leaves the rest of them to downsampleRow.
+   [[nodiscard]] static int downsampleRowBGRA(
+      const uint8_t* top,
+      const uint8_t* bottom,
+      uint8_t* half_row,
+      int half_width
+   );
+   static void downsampleRow(
+      const uint8_t* top,
+      const uint8_t* bottom,
+      uint8_t* half_row,
+      int width,
+      int half_width,
+      int channels,
+      int start_x
+   );
+   // Where the direction meets the face, with u and v in [-1, 1] along its columns and its rows
+   static void getFaceCoordinates(const glm::vec3& direction, int face, float& u, float& v);
+   static void averageFaceEdges(std::array<cv::Mat, 6>& faces);
+};
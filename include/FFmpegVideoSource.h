@@ -0,0 +1,49 @@
+#pragma once
+
+#include "VideoSource.h"
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVPacket;
+struct AVFrame;
+struct SwsContext;
+
+// Decodes with libavformat and libavcodec directly, using frame and slice threads, and converts the decoded planes
+// straight into the image of the caller.
+class FFmpegVideoSource final : public VideoSource
+{
+public:
+   FFmpegVideoSource();
+   ~FFmpegVideoSource() override;
+
+   bool open(const std::string& video_path, PixelFormat pixel_format) override;
+   void close() override;
+   bool read(cv::Mat& image) override;
+   bool skip() override;
+   bool seek(int64_t frame_index) override;
+   bool getKeyframes(std::vector<int64_t>& keyframes) override;
+   [[nodiscard]] bool isOpened() const override { return CodecContext != nullptr; }
+   [[nodiscard]] double getFPS() const override { return FPS; }
+   [[nodiscard]] cv::Size getFrameSize() const override { return FrameSize; }
+   [[nodiscard]] double getTimestamp() const override { return Timestamp; }
+
+private:
+   PixelFormat Format;
+   int StreamIndex;
+   bool Draining;
+   bool HasPendingFrame; // the frame a seek landed on, which the next read returns instead of decoding another
+   double FPS;
+   double TimeBase; // ms per tick of the stream
+   int64_t StartTime;
+   double Timestamp;
+   std::string VideoPath;
+   cv::Size FrameSize;
+   AVFormatContext* FormatContext;
+   AVCodecContext* CodecContext;
+   AVPacket* Packet;
+   AVFrame* DecodedFrame;
+   SwsContext* Converter;
+
+   bool decodeFrame();
+   bool convertFrame(cv::Mat& image);
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "_Common.h"
+
+class FrameDelta
+{
+public:
+   static constexpr int BlockSize = 16;
+
+   [[nodiscard]] static cv::Size getBlockGridSize(const cv::Size& frame_size)
+   {
+      return { (frame_size.width + BlockSize - 1) / BlockSize, (frame_size.height + BlockSize - 1) / BlockSize };
+   }
+   static void findDirtyBlocks(std::vector<uint8_t>& dirty_blocks, const cv::Mat& current, const cv::Mat& previous);
+   static void findDirtyBlocksNV12(
+      std::vector<uint8_t>& dirty_blocks,
+      const cv::Mat& current,
+      const cv::Mat& previous,
+      const cv::Size& picture_size
+   );
+   static void markAllBlocksDirty(std::vector<uint8_t>& dirty_blocks, const cv::Size& frame_size);
+   static void mergeDirtyBlocks(std::vector<uint8_t>& dirty_blocks, const std::vector<uint8_t>& other);
+   static void getDirtyRects(std::vector<cv::Rect>& dirty_rects, const std::vector<uint8_t>& dirty_blocks, const cv::Size& frame_size);
+
+private:
+   static void markDirtyBlocksInRow(uint8_t* block_row, const uint8_t* current, const uint8_t* previous, int row_bytes, int block_bytes);
+   static void markDirtyBlocksInPlane(
+      std::vector<uint8_t>& dirty_blocks,
+      const cv::Mat& current,
+      const cv::Mat& previous,
+      int block_size
+   );
+};
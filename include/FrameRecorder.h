@@ -0,0 +1,69 @@
+#pragma once
+
+#include "_Common.h"
+
+// Records the back buffer to a video file. The pixels are read into a ring of pixel pack buffers and mapped a few
+// frames later, so the render loop never waits for the GPU, and a worker thread flips them out of the mapping and
+// encodes them with cv::VideoWriter. A slot of the ring is only read into again once the worker has flipped it.
+class FrameRecorderGL
+{
+public:
+   struct Statistics
+   {
+      int64_t CapturedFrameNum;
+      int64_t EncodedFrameNum;
+      int64_t DroppedFrameNum; // the frames skipped because the readback or the encoder fell behind
+
+      Statistics() : CapturedFrameNum( 0 ), EncodedFrameNum( 0 ), DroppedFrameNum( 0 ) {}
+   };
+
+   FrameRecorderGL();
+   ~FrameRecorderGL();
+
+   FrameRecorderGL(const FrameRecorderGL&) = delete;
+   FrameRecorderGL& operator=(const FrameRecorderGL&) = delete;
+
+   // Waiting for the encoder keeps every captured frame, instead of dropping the ones the readbacks or the encoder
+   // have no room for and pacing them to the frame rate, which is what offline rendering needs. The video is MJPG
+   // either way.
+   bool start(const std::string& video_path, int width, int height, double fps, bool wait_for_encoder = false);
+   void stop();
+   void capture(int width, int height, GLuint framebuffer = 0);
+   [[nodiscard]] bool isRecording() const { return Recording; }
+   [[nodiscard]] const std::string& getVideoPath() const { return VideoPath; }
+   [[nodiscard]] Statistics getStatistics() const;
+
+private:
+   // The memory is bounded by the readback slots, which also queue the frames for the encoder.
+   inline static constexpr int ReadbackSlotNum = 8;
+
+   bool Recording;
+   bool WaitForEncoder;
+   std::string VideoPath;
+   cv::Size FrameSize;
+   double FrameDuration; // ms
+   double NextCaptureTime;
+   GLuint Buffer;
+   GLsizeiptr SlotSize;
+   uint8_t* MappedData;
+   std::array<GLsync, ReadbackSlotNum> Fences;
+   int NextSlot;
+   int PendingSlotNum; // the slots the GPU may still be reading into
+   int ReservedSlotNum; // the pending slots and the ones the encoder has not flipped yet
+   cv::VideoWriter Writer;
+   std::thread Encoder;
+   mutable std::mutex Lock;
+   std::condition_variable FrameQueued;
+   std::condition_variable SlotReleased;
+   std::deque<int> QueuedSlots;
+   bool StopEncoding;
+   Statistics RecordStatistics;
+
+   [[nodiscard]] static double getNow();
+   [[nodiscard]] int getOldestPendingSlot() const
+   {
+      return (NextSlot - PendingSlotNum + ReadbackSlotNum) % ReadbackSlotNum;
+   }
+   bool collectSlot(int slot, bool wait);
+   void encode();
+};
\ No newline at end of file
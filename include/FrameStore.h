@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MappedFile.h"
+
+// A file of decoded video frames, compressed with LZ4 when it is available, followed by an index of their offsets.
+// The header records the source video, so a store is only used while the source is unchanged.
+class FrameStore
+{
+public:
+   struct SourceStamp
+   {
+      uint64_t Hash;
+      int64_t Size;
+      int64_t ModifiedTime;
+
+      SourceStamp() : Hash( 0 ), Size( -1 ), ModifiedTime( 0 ) {}
+   };
+
+   FrameStore();
+   ~FrameStore();
+
+   [[nodiscard]] static SourceStamp getSourceStamp(const std::string& source_path);
+   [[nodiscard]] static std::string getStorePath(
+      const std::string& directory,
+      const std::string& source_path,
+      int pixel_format
+   );
+   // Evicts stores until the directory fits the limit, and returns the bytes left in it. The stores being written
+   // count toward the limit but are never evicted.
+   static int64_t enforceSizeLimit(
+      const std::string& directory,
+      int64_t size_limit,
+      const std::string& kept_store_path
+   );
+   bool openForReading(const std::string& store_path, const SourceStamp& stamp);
+   bool readFrame(cv::Mat& image, int64_t index) const;
+   bool beginWriting(const std::string& store_path, const SourceStamp& stamp, double fps);
+   bool writeFrame(const cv::Mat& image, double timestamp);
+   bool finishWriting();
+   void abortWriting();
+   void close();
+   [[nodiscard]] int64_t getFrameNum() const { return static_cast<int64_t>(Index.size()); }
+   [[nodiscard]] double getFPS() const { return Header.FPS; }
+   [[nodiscard]] cv::Size getFrameSize() const { return { Header.Cols, Header.Rows }; }
+   [[nodiscard]] int getFrameType() const { return Header.Type; }
+   [[nodiscard]] double getTimestamp(int64_t index) const { return Index[index].Timestamp; }
+   [[nodiscard]] int64_t getWrittenBytes() const { return static_cast<int64_t>(WrittenBytes); }
+
+private:
+   struct StoreHeader
+   {
+      char Magic[4];
+      uint32_t Version;
+      uint32_t Compression; // 0 for raw frames and 1 for LZ4
+      int32_t Type, Rows, Cols;
+      double FPS;
+      uint64_t SourceHash;
+      int64_t SourceSize;
+      int64_t SourceModifiedTime;
+      uint64_t FrameNum;
+      uint64_t IndexOffset; // 0 until the store is complete
+   };
+
+   struct IndexEntry
+   {
+      uint64_t Offset;
+      uint64_t Size;
+      double Timestamp;
+   };
+
+   inline static const std::string Extension = ".frames";
+   StoreHeader Header;
+   std::vector<IndexEntry> Index;
+   MappedFile Store;
+   StagedFileWriter Writer;
+   uint64_t WrittenBytes;
+   std::vector<char> CompressedFrame;
+
+   [[nodiscard]] static uint32_t getCompression();
+};
\ No newline at end of file
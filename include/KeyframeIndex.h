@@ -0,0 +1,23 @@
+#pragma once
+
+#include "_Common.h"
+
+// The frame indices of the keyframes of a video, kept in a <video>.keyframes sidecar with one index per line.
+class KeyframeIndex
+{
+public:
+   KeyframeIndex() = default;
+
+   bool load(const std::string& video_path);
+   bool save(const std::string& video_path) const;
+   void set(std::vector<int64_t> keyframes);
+   void clear() { Keyframes.clear(); }
+   // The last keyframe at or before the frame, or the frame itself when nothing is known about the keyframes.
+   [[nodiscard]] int64_t findKeyframe(int64_t frame_index) const;
+   [[nodiscard]] bool empty() const { return Keyframes.empty(); }
+
+private:
+   std::vector<int64_t> Keyframes;
+
+   [[nodiscard]] static std::string getSidecarPath(const std::string& video_path) { return video_path + ".keyframes"; }
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "_Common.h"
+
+// A read-only view of a whole file in memory.
+class MappedFile
+{
+public:
+   MappedFile();
+   ~MappedFile();
+
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   bool open(const std::string& file_path);
+   void close();
+   [[nodiscard]] bool isOpened() const { return Data != nullptr; }
+   [[nodiscard]] const uint8_t* getData() const { return Data; }
+   [[nodiscard]] size_t getSize() const { return Size; }
+
+private:
+   const uint8_t* Data;
+   size_t Size;
+#ifdef _WIN32
+   void* File;
+   void* Mapping;
+#else
+   int File;
+#endif
+};
+
+// Hashes bytes with 64-bit FNV-1a, which is enough to tell the files the caches are made of apart.
+class ContentHasher
+{
+public:
+   ContentHasher() : Hash( 14695981039346656037ull ) {}
+
+   void add(const void* bytes, size_t byte_num)
+   {
+      const auto* data = static_cast<const uint8_t*>(bytes);
+      for (size_t i = 0; i < byte_num; ++i) {
+         Hash ^= data[i];
+         Hash *= 1099511628211ull;
+      }
+   }
+   [[nodiscard]] uint64_t getHash() const { return Hash; }
+
+private:
+   uint64_t Hash;
+};
+
+// Writes a file under a temporary name, which it only trades for its own once it is complete, so a file cut off by
+// a crash is never read.
+class StagedFileWriter
+{
+public:
+   inline static const std::string Extension = ".part";
+
+   StagedFileWriter() = default;
+   ~StagedFileWriter();
+
+   StagedFileWriter(const StagedFileWriter&) = delete;
+   StagedFileWriter& operator=(const StagedFileWriter&) = delete;
+
+   bool open(const std::string& file_path);
+   // Renames the file if everything was written, and removes it otherwise.
+   bool commit(bool complete = true);
+   void abort();
+   [[nodiscard]] bool isOpened() const { return Writer.is_open(); }
+   [[nodiscard]] std::ofstream& getStream() { return Writer; }
+
+private:
+   std::string FilePath;
+   std::ofstream Writer;
+};
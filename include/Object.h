@@ -1,12 +1,44 @@
 #pragma once
 
 #include "Shader.h"
+#include "VideoCube.h"
+#include "CubeFaceLoader.h"
+#include "CubeMapFile.h"
+#include "CubeMipGenerator.h"
+#include "UploadBuffer.h"
+#include "SharedFrameRing.h"
 
 class ObjectGL
 {
 public:
    enum LayoutLocation { VertexLoc = 0, NormalLoc, TextureLoc };
 
+   struct UploadStatistics
+   {
+      int64_t UploadedBytes;
+      int64_t SavedBytes;       // bytes of new frames that were not uploaded because they did not change
+      int64_t SkippedUploadNum; // new frames without any change
+      double UploadTime;        // ms the render thread spent copying committed frames and issuing their uploads
+
+      UploadStatistics() : UploadedBytes( 0 ), SavedBytes( 0 ), SkippedUploadNum( 0 ), UploadTime( 0.0 ) {}
+   };
+
+   struct CubeLoadStatistics
+   {
+      std::array<double, 6> DecodeTimes; // ms each face took to decode on its thread
+      std::array<double, 6> UploadTimes; // ms the render thread took to upload each face, every level of it
+      std::array<double, 6> ReadyTimes;  // ms from the start until the first level of each face was uploaded
+      double MipTime;                    // ms it took to make the levels below the first
+      double PreviewTime;                // ms until the cube could be drawn with the smaller levels
+      double LoadTime;                   // ms until the whole cube was uploaded
+      int PreviewLevel;                  // the first level the cube was drawn with
+      bool Cached;                       // whether the cube was uploaded from a cube map file
+
+      CubeLoadStatistics() :
+         DecodeTimes{}, UploadTimes{}, ReadyTimes{}, MipTime( 0.0 ), PreviewTime( 0.0 ), LoadTime( 0.0 ),
+         PreviewLevel( 0 ), Cached( false ) {}
+   };
+
    ObjectGL();
    ~ObjectGL();
 
@@ -42,16 +74,45 @@ public:
       const std::string& texture_file_path,
       bool is_grayscale = false
    );
-   void setCubeObject(
+   // The cube is drawn right away with its smaller levels, and the larger ones are uploaded by updateCubeTexture as
+   // they come. With a cache directory, the first load of the images keeps the whole cube map there, mip levels and
+   // all, and the next loads of the same images upload it from there without decoding them. It returns false when
+   // a face cannot be read.
+   bool setCubeObject(
+      GLenum draw_mode,
+      const std::vector<glm::vec3>& vertices,
+      const std::vector<std::string>& texture_directory_path_set,
+      const std::string& cache_directory = std::string()
+   );
+   // A cube map file made by CubeMapCompress, uploaded into storage of its own, compressed or not
+   bool setCubeObject(GLenum draw_mode, const std::vector<glm::vec3>& vertices, const std::string& cube_map_path);
+   void setVideoObject(
+      GLenum draw_mode,
+      const std::vector<glm::vec3>& vertices,
+      const std::vector<std::string>& texture_video_path_set,
+      const VideoSource::Settings& source_settings = VideoSource::Settings()
+   );
+   // A single video covering the whole cube, which the source settings resample into a cube atlas
+   void setVideoObject(
       GLenum draw_mode,
       const std::vector<glm::vec3>& vertices,
-      const std::vector<std::string>& texture_directory_path_set
+      const std::string& video_path,
+      const VideoSource::Settings& source_settings
    );
    void setVideoObject(
       GLenum draw_mode,
       const std::vector<glm::vec3>& vertices,
-      const std::vector<std::string>& texture_video_path_set
+      const std::vector<std::vector<std::string>>& rendition_video_path_sets,
+      const VideoSource::Settings& source_settings = VideoSource::Settings()
+   );
+   void setTiledVideoObject(
+      GLenum draw_mode,
+      const std::vector<glm::vec3>& vertices,
+      const std::vector<std::string>& face_directory_path_set,
+      int tile_num,
+      const VideoSource::Settings& source_settings = VideoSource::Settings()
    );
+   void setLiveVideoObject(GLenum draw_mode, const std::vector<glm::vec3>& vertices, const std::string& ring_name);
    void setSquareObject(GLenum draw_mode, bool use_texture = true);
    void setSquareObject(
       GLenum draw_mode,
@@ -62,13 +123,21 @@ public:
    void addTexture(int width, int height, bool is_grayscale = false);
    int addTexture(const uint8_t* image_buffer, int width, int height, bool is_grayscale = false);
    void transferUniformsToShader(const ShaderGL* shader);
+   void transferVideoUniformsToShader(const ShaderGL* shader) const;
    void updateDataBuffer(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals);
    void updateDataBuffer(
       const std::vector<glm::vec3>& vertices,
       const std::vector<glm::vec3>& normals,
       const std::vector<glm::vec2>& textures
    );
-   void updateVideoCubeTextures();
+   // Uploads the next levels of a static cube that is still loading, and returns true once the last one is in.
+   bool updateCubeTexture();
+   void updateVideoCubeTextures(const CameraGL* camera);
+   void seekVideo(double time, VideoCube::SeekMode mode) const;
+   // Videos set after this play stepped by stepVideo, as offline rendering needs.
+   void setVideoStepped(bool stepped) { VideoStepped = stepped; }
+   void stepVideo(int64_t index) const;
+   [[nodiscard]] bool hasVideoEnded() const;
    void replaceVertices(const std::vector<glm::vec3>& vertices, bool normals_exist, bool textures_exist);
    void replaceVertices(const std::vector<float>& vertices, bool normals_exist, bool textures_exist);
    [[nodiscard]] GLuint getVAO() const { return VAO; }
@@ -76,6 +145,12 @@ public:
    [[nodiscard]] GLsizei getVertexNum() const { return VerticesCount; }
    [[nodiscard]] GLuint getTextureID(int index) const { return TextureID[index]; }
    [[nodiscard]] int getTextureNum() const { return static_cast<int>(TextureID.size()); }
+   [[nodiscard]] GLuint getChromaTextureID(int index) const { return ChromaTextureID[index]; }
+   [[nodiscard]] int getChromaTextureNum() const { return static_cast<int>(ChromaTextureID.size()); }
+   [[nodiscard]] const VideoCube* getVideo() const { return Video.get(); }
+   [[nodiscard]] const UploadStatistics& getVideoUploadStatistics() const { return VideoUploadStatistics; }
+   [[nodiscard]] const CubeLoadStatistics& getCubeLoadStatistics() const { return CubeStatistics; }
+   [[nodiscard]] bool isCubeStreaming() const { return IsCubeStreaming; }
 
    template<typename T>
    void addShaderStorageBufferObject(const std::string& name, GLuint binding_index, int data_size)
@@ -112,15 +187,49 @@ public:
    }
 
 private:
+   struct VideoFaceArea
+   {
+      int Face;
+      cv::Rect Area;    // the part of the stream picture shown on the face
+      cv::Point Origin; // where the part starts in the face texture
+   };
+
    uint8_t* ImageBuffer;
    std::vector<GLfloat> DataBuffer;
    GLuint VAO;
    GLuint VBO;
    GLenum DrawMode;
    std::vector<GLuint> TextureID;
-   std::vector<cv::VideoCapture> Videos;
+   std::vector<GLuint> ChromaTextureID; // the UV planes of NV12 video, where TextureID holds the Y planes
+   std::unique_ptr<VideoCube> Video;
+   std::unique_ptr<SharedFrameRing> LiveVideo; // the faces published by another process, used instead of Video
+   uint64_t LiveVideoSequence;
+   VideoStream::PixelFormat VideoFormat;
+   BlockFormat VideoCompression;
+   bool EquiAngularVideo;
+   bool VideoStepped;
+   std::vector<VideoStream::Frame> VideoFrames;
+   std::vector<bool> UpdatedVideoFaces;
+   std::array<std::vector<std::vector<uint8_t>>, 2> VideoStaleBlocks;
+   std::vector<cv::Rect> DirtyRects;
+   std::vector<VideoFaceArea> VideoFaceAreas;
+   UploadStatistics VideoUploadStatistics;
+   CubeLoadStatistics CubeStatistics;
+   std::chrono::steady_clock::time_point CubeLoadStart;
+   std::thread CubeMapWorker; // decodes the whole faces and makes their levels, then writes them to the cache
+   std::atomic<bool> CubeLevelsDecoded;
+   std::atomic<bool> CubeLevelsFailed;
+   std::vector<std::array<cv::Mat, 6>> DecodedCubeLevels; // only read once CubeLevelsDecoded is set
+   CubeMapFile StreamedCubeMap; // the cube map whose levels are still being uploaded, if any
+   bool IsCubeStreaming;
+   int StreamedLevel;  // the level and the face to upload next, from the smallest level up
+   int StreamedFace;
+   int ResidentLevel;  // the base level of the texture, the largest one with all the faces in
+   std::unique_ptr<UploadBufferGL> VideoUploadBuffer;
    std::map<std::string, GLuint> CustomBuffers;
    GLsizei VerticesCount;
+   glm::ivec2 CubeFaceSize;
+   float CubeHalfLength;
    glm::vec4 EmissionColor;
    glm::vec4 AmbientReflectionColor; // It is usually set to the same color with DiffuseReflectionColor.
                                      // Otherwise, it should be in balance with DiffuseReflectionColor.
@@ -132,7 +241,67 @@ private:
    void prepareTexture(bool normals_exist) const;
    void prepareVertexBuffer(int n_bytes_per_vertex);
    void prepareNormal() const;
+   [[nodiscard]] bool isPlanarVideo() const { return VideoFormat == VideoStream::PixelFormat::NV12; }
+   [[nodiscard]] bool isCompressedVideo() const { return VideoCompression != BlockFormat::None; }
+   [[nodiscard]] static GLuint createCubeTexture(
+      int width,
+      int height,
+      GLenum internal_format = GL_RGB8,
+      int level_num = 1
+   );
+   void loadCubeFaces(const std::vector<std::string>& image_paths, std::vector<std::array<cv::Mat, 6>>& levels);
+   [[nodiscard]] bool loadCubePreview(const std::vector<std::string>& image_paths);
+   void decodeCubeLevels(
+      const std::vector<std::string>& image_paths,
+      const cv::Size& face_size,
+      const std::string& cache_path,
+      uint64_t content_hash
+   );
+   void uploadCubeMapFile();
+   void resetCubeStream();
+   void startCubeStream(int resident_level, int first_streamed_level);
+   size_t uploadStreamedCubeFace(int level, int face);
    void prepareCubeTextures(const std::vector<cv::Mat>& cube_image_set);
+   void prepareCompressedCubeTextures(const std::vector<cv::Mat>& cube_image_set);
+   void setVideoCubeVertices(GLenum draw_mode, const std::vector<glm::vec3>& vertices);
+   void selectVideoCompression(const std::vector<cv::Mat>& first_frames, BlockFormat compression);
+   void prepareVideoUploadBuffer(const std::vector<cv::Mat>& first_frames);
+   void addVideoCubeTextures(const cv::Size& picture_size);
+   void prepareVideoCubeTextures(const std::vector<cv::Mat>& first_frames);
+   [[nodiscard]] static GLuint createScaledCubeTexture(
+      GLuint texture_id,
+      const glm::ivec2& size,
+      const glm::ivec2& new_size,
+      GLenum internal_format,
+      const std::array<GLuint, 2>& framebuffers
+   );
+   void resizeVideoCubeTextures(const cv::Size& picture_size);
+   void replaceVideoCubeTextures(const std::vector<cv::Mat>& first_frames);
+   void resetVideoStaleBlocks(const std::vector<cv::Mat>& first_frames, bool textures_hold_first_frames);
+   [[nodiscard]] GLsizeiptr uploadVideoRect(
+      GLuint texture_id,
+      uint8_t* slot,
+      GLintptr offset_in_slot,
+      const cv::Mat& plane,
+      const cv::Rect& rect,
+      const cv::Point& offset,
+      int face,
+      GLenum format
+   ) const;
+   [[nodiscard]] GLsizeiptr uploadVideoBlocks(
+      GLuint texture_id,
+      uint8_t* slot,
+      GLintptr offset_in_slot,
+      const cv::Mat& blocks,
+      const cv::Rect& rect,
+      const cv::Point& offset,
+      int face
+   ) const;
+   void updateVideoFaceAreas(int stream, const cv::Size& picture_size);
+   void uploadVideoFrame(int texture_index, int stream);
+   void copyStaleVideoRects(int stream);
+   void updateLiveVideoCubeTextures();
+   static void swapVideoCubeTextures(std::vector<GLuint>& texture_ids);
    static void getSquareObject(
       std::vector<glm::vec3>& vertices,
       std::vector<glm::vec3>& normals,
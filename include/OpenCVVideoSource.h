@@ -0,0 +1,25 @@
+#pragma once
+
+#include "VideoSource.h"
+
+// VideoCapture only hands out BGR frames, so NV12 is not opened rather than converted back from BGR on the CPU.
+// It does not tell keyframes from the other frames either, so the keyframes only come from a sidecar file.
+class OpenCVVideoSource final : public VideoSource
+{
+public:
+   OpenCVVideoSource();
+   ~OpenCVVideoSource() override;
+
+   bool open(const std::string& video_path, PixelFormat pixel_format) override;
+   void close() override;
+   bool read(cv::Mat& image) override;
+   bool skip() override;
+   bool seek(int64_t frame_index) override;
+   [[nodiscard]] bool isOpened() const override { return Video.isOpened(); }
+   [[nodiscard]] double getFPS() const override;
+   [[nodiscard]] cv::Size getFrameSize() const override;
+   [[nodiscard]] double getTimestamp() const override;
+
+private:
+   cv::VideoCapture Video;
+};
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "_Common.h"
+
+class PlaybackClock
+{
+public:
+   PlaybackClock();
+
+   void start();
+   void pause(double time); // holds the clock at the time in ms
+   void resume();
+   [[nodiscard]] double getTime() const;
+   [[nodiscard]] bool isPaused() const { return PausedTime >= 0.0; }
+
+private:
+   // The decoders read the clock on their own threads, so the state is kept in atomics.
+   std::atomic<int64_t> StartTime; // steady_clock ticks
+   std::atomic<double> PausedTime; // negative while running
+
+   [[nodiscard]] static int64_t getNow() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+};
\ No newline at end of file
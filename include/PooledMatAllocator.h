@@ -0,0 +1,66 @@
+#pragma once
+
+#include "_Common.h"
+
+// Keeps the pixel buffers of released images in free lists by size class, so that images of the sizes seen before
+// are allocated without going to the system. A size class is a quarter of a power of two, and every pooled buffer
+// starts on a page. With huge pages, the buffers of 2 MiB and more are aligned to 2 MiB and advised to use them.
+class PooledMatAllocator final : public cv::MatAllocator
+{
+public:
+   struct Statistics
+   {
+      int64_t AllocationNum;
+      int64_t PoolHitNum;      // allocations served from a free list
+      int64_t UsedBytes;       // bytes of the buffers held by images
+      int64_t PooledBytes;     // bytes of the buffers in the free lists
+      int64_t PeakBytes;       // the most bytes of used and pooled buffers at once
+      int64_t HugePageBytes;   // bytes of the buffers advised to use huge pages so far
+
+      Statistics() :
+         AllocationNum( 0 ), PoolHitNum( 0 ), UsedBytes( 0 ), PooledBytes( 0 ), PeakBytes( 0 ), HugePageBytes( 0 ) {}
+   };
+
+   PooledMatAllocator(const PooledMatAllocator&) = delete;
+   PooledMatAllocator& operator=(const PooledMatAllocator&) = delete;
+
+   // The allocator lives as long as the process, because images may be released during static destruction.
+   [[nodiscard]] static PooledMatAllocator* getInstance();
+   void setHugePages(bool use_huge_pages) { UseHugePages = use_huge_pages; }
+   void setPooledByteLimit(int64_t limit);
+   void trim(); // frees the buffers in the free lists
+   [[nodiscard]] Statistics getStatistics() const;
+
+   cv::UMatData* allocate(
+      int dims,
+      const int* sizes,
+      int type,
+      void* data,
+      size_t* step,
+      cv::AccessFlag flags,
+      cv::UMatUsageFlags usage_flags
+   ) const override;
+   bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override;
+   void deallocate(cv::UMatData* data) const override;
+
+private:
+   inline static constexpr size_t MinPooledSize = 4096; // smaller buffers are not pooled
+   inline static constexpr size_t PageSize = 4096;
+   inline static constexpr size_t HugePageSize = 2 << 20;
+   inline static constexpr size_t SimdAlignment = 64;
+
+   std::atomic<bool> UseHugePages;
+   int64_t PooledByteLimit;
+   mutable std::mutex Lock;
+   mutable std::vector<std::vector<uint8_t*>> FreeLists;
+   mutable Statistics PoolStatistics;
+
+   PooledMatAllocator();
+   ~PooledMatAllocator() override = default;
+
+   [[nodiscard]] static int getSizeClass(size_t size);
+   [[nodiscard]] static size_t getClassSize(int size_class);
+   [[nodiscard]] uint8_t* allocateBuffer(size_t size, size_t alignment, bool huge_pages) const;
+   static void freeBuffer(uint8_t* buffer);
+   void updatePeakBytes() const;
+};
\ No newline at end of file
@@ -11,6 +11,9 @@
 
 #include "_Common.h"
 #include "Object.h"
+#include "FrameRecorder.h"
+#include "CameraPath.h"
+#include "PooledMatAllocator.h"
 
 class RendererGL
 {
@@ -24,7 +27,16 @@ public:
    RendererGL();
    ~RendererGL();
 
+   // The cube shows the static sample faces unless another scene is set before play or renderOffline.
+   // Cube videos are a directory of right, left, top, bottom, back and front.avi, or with tiles, a directory of face
+   // directories named the same, each with base.avi and its tiles. The other projections take a single video.
+   // An empty video path stands for the dynamic samples.
+   void setVideo(const std::string& video_path, const VideoSource::Settings& settings, int tile_num = 0);
+   void setLiveVideo(const std::string& ring_name);
+   void setCubeMap(const std::string& cube_map_path);
    void play();
+   // Renders every frame of the cube video along the camera path into a video, as fast as the stages allow.
+   bool renderOffline(const std::string& camera_path, const std::string& video_path, int width, int height);
 
 private:
    inline static RendererGL* Renderer = nullptr;
@@ -32,10 +44,18 @@ private:
    int FrameWidth;
    int FrameHeight;
    bool IsVideo;
+   int VideoTileNum; // the tiles per side of each face for a tiled video source, or 0 for six plain videos
+   VideoSource::Settings VideoSettings;
+   std::string VideoPath; // the videos or the face directories to show, or empty for the dynamic samples
+   std::string LiveVideoRing; // the shared frame ring to show instead of the sample videos, or empty
+   std::string CubeCacheDirectory; // where the static cube maps are kept for the next starts, or empty for no cache
+   std::string CubeMapPath; // a cube map file made by CubeMapCompress to show instead of the sample faces, or empty
    glm::ivec2 ClickedPoint;
    std::unique_ptr<CameraGL> MainCamera;
    std::unique_ptr<ShaderGL> ObjectShader;
    std::unique_ptr<ObjectGL> CubeObject;
+   std::unique_ptr<FrameRecorderGL> Recorder;
+   double RecordingFPS;
  
    void registerCallbacks() const;
    void initialize();
@@ -57,7 +77,9 @@ private:
    static void mousewheelWrapper(GLFWwindow* window, double xoffset, double yoffset);
    static void reshapeWrapper(GLFWwindow* window, int width, int height);
 
-   void setCubeObject(float length = 1.0f) const;
-   void drawCubeObject() const;
+   void setCubeObject(float length = 1.0f);
+   void printCubeLoadStatistics() const;
+   void prepareScene();
+   void drawCubeObject(GLuint framebuffer, int width, int height) const;
    void render() const;
 };
\ No newline at end of file
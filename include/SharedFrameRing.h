@@ -0,0 +1,97 @@
+#pragma once
+
+#include "_Common.h"
+
+// A ring of cube frames in a POSIX shared memory object, written by one producer process and read by one consumer.
+//
+// Layout, with every offset from the start of the object:
+//   0                  Header
+//   SlotTableOffset    SlotNum x Slot
+//   DataOffset         SlotNum x SlotStride bytes. A slot holds FaceNum faces, FaceStride bytes apart, in the order
+//                      of the cube map faces (+X, -X, +Y, -Y, +Z, -Z). A face is a tightly packed BGR image of
+//                      Height rows of Width * 3 bytes, or an NV12 image of Height * 3 / 2 rows of Width bytes.
+//
+// The ring is a mailbox of at least 3 slots. The producer fills a slot that is neither LatestSlot nor ReaderSlot,
+// writes its Slot entry, stores it in LatestSlot, increments Notification and wakes the futex on it.
+// The consumer stores LatestSlot in ReaderSlot, and holds the slot once LatestSlot still matches after that.
+// The producer never writes the held slot, so the consumer reads the faces in place without copying them.
+class SharedFrameRing
+{
+public:
+   static constexpr uint32_t CurrentVersion = 1;
+
+   struct Header
+   {
+      char Magic[8]; // "CMRING" followed by zeros
+      uint32_t Version;
+      uint32_t FaceNum;
+      uint32_t SlotNum;
+      uint32_t Width;
+      uint32_t Height;
+      uint32_t PixelFormat; // 0 for BGR and 1 for NV12
+      uint64_t FaceStride;
+      uint64_t SlotStride;
+      uint64_t SlotTableOffset;
+      uint64_t DataOffset;
+      double FPS;
+      std::atomic<uint32_t> LatestSlot; // SlotNum until the first frame is published
+      std::atomic<uint32_t> ReaderSlot; // SlotNum while the consumer holds no slot
+      std::atomic<uint32_t> Notification;
+      uint32_t Reserved;
+      std::atomic<uint64_t> PublishedNum;
+   };
+
+   struct Slot
+   {
+      uint64_t Sequence; // the number of frames published before this one
+      int64_t FrameIndex;
+      double Timestamp; // ms on the clock of the producer
+   };
+
+   SharedFrameRing();
+   ~SharedFrameRing();
+
+   SharedFrameRing(const SharedFrameRing&) = delete;
+   SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+
+   bool create(
+      const std::string& name,
+      int face_num,
+      int slot_num,
+      int width,
+      int height,
+      uint32_t pixel_format,
+      double fps
+   );
+   bool open(const std::string& name);
+   void close();
+   [[nodiscard]] uint8_t* beginWrite();
+   void publish(int64_t frame_index, double timestamp);
+   bool acquireLatest(uint64_t& last_sequence);
+   void release();
+   bool waitForFrame(uint64_t last_sequence, int timeout_ms) const;
+   [[nodiscard]] bool isOpened() const { return Data != nullptr; }
+   [[nodiscard]] const Header& getHeader() const { return *RingHeader; }
+   [[nodiscard]] const Slot& getHeldSlot() const { return getSlotTable()[HeldSlot]; }
+   [[nodiscard]] const uint8_t* getFace(int face) const
+   {
+      return Data + RingHeader->DataOffset + HeldSlot * RingHeader->SlotStride + face * RingHeader->FaceStride;
+   }
+   [[nodiscard]] static uint64_t getFaceSize(int width, int height, uint32_t pixel_format)
+   {
+      const auto pixel_num = static_cast<uint64_t>(width) * height;
+      return pixel_format == 1 ? pixel_num * 3 / 2 : pixel_num * 3;
+   }
+
+private:
+   std::string Name;
+   bool Owner;
+   uint8_t* Data;
+   size_t Size;
+   Header* RingHeader;
+   uint32_t WritingSlot;
+   uint32_t HeldSlot;
+
+   [[nodiscard]] Slot* getSlotTable() const { return reinterpret_cast<Slot*>(Data + RingHeader->SlotTableOffset); }
+   bool map(int descriptor, size_t size);
+};
\ No newline at end of file
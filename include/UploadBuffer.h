@@ -0,0 +1,28 @@
+#pragma once
+
+#include "_Common.h"
+
+class UploadBufferGL
+{
+public:
+   UploadBufferGL();
+   ~UploadBufferGL();
+
+   void setBuffer(GLsizeiptr slot_size, int slot_num);
+   [[nodiscard]] uint8_t* acquireSlot();
+   void releaseSlot();
+   [[nodiscard]] GLuint getBuffer() const { return Buffer; }
+   [[nodiscard]] GLsizeiptr getSlotSize() const { return SlotSize; }
+   [[nodiscard]] GLintptr getCurrentOffset() const { return static_cast<GLintptr>(CurrentSlot) * SlotSize; }
+   [[nodiscard]] int getStallNum() const { return StallNum; }
+
+private:
+   GLuint Buffer;
+   GLsizeiptr SlotSize;
+   int CurrentSlot;
+   int StallNum;
+   uint8_t* MappedData;
+   std::vector<GLsync> Fences;
+
+   void deleteBuffer();
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "VideoStream.h"
+#include "CubeFaceRemap.h"
+
+class VideoCube
+{
+public:
+   // A keyframe seek shows the keyframe before the target on every stream, which is fast enough for scrubbing.
+   // It is refined to the exact frame once no other seek has come for a while.
+   enum class SeekMode { Exact = 0, Keyframe };
+
+   struct DriftStatistics
+   {
+      int64_t CommittedSetNum; // frame sets published with all streams on the same index
+      int64_t HeldSetNum;      // updates where a due set was incomplete and the previous set was kept
+      int64_t DiscardedFrameNum;
+      int64_t CurrentDrift;    // frames between the most advanced and the least advanced decoder
+      int64_t MaxDrift;
+
+      DriftStatistics() : CommittedSetNum( 0 ), HeldSetNum( 0 ), DiscardedFrameNum( 0 ), CurrentDrift( 0 ),
+      MaxDrift( 0 ) {}
+   };
+
+   // The sums over all the streams since they were opened
+   struct StreamStatistics
+   {
+      VideoSource::StageTimes Stages;
+      double CompressTime;     // ms spent block-compressing frames
+      int64_t DroppedFrameNum; // decoded frames that were never shown
+      int64_t SkippedFrameNum; // overdue frames that were decoded without being converted
+      int64_t ResyncNum;
+
+      StreamStatistics() : CompressTime( 0.0 ), DroppedFrameNum( 0 ), SkippedFrameNum( 0 ), ResyncNum( 0 ) {}
+   };
+
+   struct StreamRegion
+   {
+      int Face; // -1 when the stream is a cube atlas covering all the faces
+      int Row, Column; // the tile of the face, or -1 when the stream covers the whole face
+
+      StreamRegion() : Face( 0 ), Row( -1 ), Column( -1 ) {}
+      StreamRegion(int face, int row, int column) : Face( face ), Row( row ), Column( column ) {}
+      [[nodiscard]] bool isTile() const { return Row >= 0; }
+      [[nodiscard]] bool isAtlas() const { return Face < 0; }
+   };
+
+   VideoCube();
+   ~VideoCube();
+
+   // NV12 falls back to BGR on decoders that do not output YUV.
+   void setSourceSettings(const VideoSource::Settings& settings);
+   bool open(const std::vector<std::string>& video_paths, std::vector<cv::Mat>& first_frames);
+   bool openRenditions(
+      const std::vector<std::vector<std::string>>& rendition_path_sets,
+      std::vector<cv::Mat>& first_frames
+   );
+   // The streams of a new rendition are opened on a thread of their own while the current ones play on, and they
+   // replace them once their first frames are decoded, which is when true is returned with those frames.
+   bool updateRendition(float fov, int viewport_height, std::vector<cv::Mat>& first_frames);
+   bool openAtlas(const std::string& video_path, std::vector<cv::Mat>& first_frames);
+   bool openTiled(const std::vector<std::string>& face_directory_paths, int tile_num, std::vector<cv::Mat>& first_frames);
+   // Offline rendering starts stepped, with the clock held on the first frame instead of following the wall clock.
+   void play(bool stepped = false);
+   void seek(double time, SeekMode mode);
+   // Offline rendering holds the clock in the middle of each frame in turn instead of following the wall clock.
+   void stepTo(int64_t index);
+   [[nodiscard]] bool hasEnded();
+   // Keyframe seeks need the keyframes of every stream, from the source or from a sidecar written by another run.
+   [[nodiscard]] bool hasKeyframes() const;
+   void updateVisibility(const glm::mat4& view_projection, float half_length);
+   bool commitFrames(std::vector<VideoStream::Frame>& frames, std::vector<bool>& updated);
+   [[nodiscard]] int getStreamNum() const { return static_cast<int>(Streams.size()); }
+   [[nodiscard]] int getTileNum() const { return TileNum; }
+   [[nodiscard]] VideoStream::PixelFormat getPixelFormat() const { return SourceSettings.Format; }
+   [[nodiscard]] int getRendition() const { return Rendition; }
+   [[nodiscard]] int getRenditionNum() const { return static_cast<int>(RenditionPathSets.size()); }
+   [[nodiscard]] double getDecodeHeadroom() const;
+   [[nodiscard]] const StreamRegion& getStreamRegion(int stream) const { return Regions[stream]; }
+   [[nodiscard]] uint getResidentTileMask(int face) const { return ResidentTileMasks[face]; }
+   [[nodiscard]] int getVisibleStreamNum() const
+   {
+      return static_cast<int>(std::count( Visible.begin(), Visible.end(), true ));
+   }
+   [[nodiscard]] int64_t getCommittedIndex() const { return CommittedIndex; }
+   [[nodiscard]] double getTime() const { return Clock.getTime(); }
+   [[nodiscard]] double getFrameDuration() const { return Streams.empty() ? 0.0 : Streams[0]->getFrameDuration(); }
+   [[nodiscard]] bool isSeeking() const { return SeekIndex >= 0; }
+   [[nodiscard]] const DriftStatistics& getDriftStatistics() const { return Drift; }
+   [[nodiscard]] StreamStatistics getStreamStatistics() const;
+
+private:
+   const float VisibilityMargin; // the frustum is widened by this factor so that streams are resumed before they appear
+   const double MinDecodeHeadroom; // a rendition is dropped when decoding takes more than 1 / this of a frame
+   const double RenditionSwitchInterval; // ms between rendition switches
+   const double SeekRefineDelay; // ms without a new seek before a keyframe seek is refined
+   int TileNum;
+   VideoSource::Settings SourceSettings;
+   int Rendition;
+   double LastRenditionSwitchTime;
+   std::vector<std::vector<std::string>> RenditionPathSets;
+   std::vector<int> RenditionWidths;
+   int PendingRendition; // the rendition being opened, or -1
+   std::thread RenditionOpener;
+   std::atomic<bool> RenditionOpened;
+   std::vector<std::unique_ptr<VideoStream>> PendingStreams; // empty when the rendition could not be opened
+   std::vector<cv::Mat> PendingFirstFrames;
+   int64_t CommittedIndex;
+   int64_t SeekIndex; // the frame every stream is seeking to, or -1
+   SeekMode PendingSeekMode;
+   bool SeekPreviewShown;
+   std::chrono::steady_clock::time_point LastSeekTime;
+   DriftStatistics Drift;
+   PlaybackClock Clock;
+   std::vector<std::unique_ptr<VideoStream>> Streams;
+   std::vector<StreamRegion> Regions;
+   std::vector<std::vector<int64_t>> DueIndices;
+   std::vector<bool> Visible;
+   std::vector<bool> Synced;
+   std::vector<int> Participants;
+   std::array<uint, 6> ResidentTileMasks;
+
+   bool openStream(const std::string& video_path, const StreamRegion& region, cv::Mat& first_frame);
+   bool openStreams(const std::vector<std::string>& video_paths, std::vector<cv::Mat>& first_frames);
+   [[nodiscard]] int selectRendition(float fov, int viewport_height) const;
+   void openPendingRendition();
+   void stopRenditionOpener();
+   void resetPlaybackState();
+   [[nodiscard]] glm::vec2 getRegionMin(const StreamRegion& region) const;
+   [[nodiscard]] glm::vec2 getRegionMax(const StreamRegion& region) const;
+   [[nodiscard]] bool isRegionInFrustum(const glm::mat4& view_projection, float half_length, const StreamRegion& region) const;
+   void updateParticipants();
+   void updateDrift();
+   [[nodiscard]] int64_t findCompleteIndex() const;
+   void discardIncompleteFrames();
+   void updateResidentTileMasks(const std::vector<bool>& updated);
+   void updateSeek(int64_t committed_index);
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "BlockCompressor.h"
+
+// A decoder of one video file. Frames are written into the images given by the caller, in place when an image
+// already has the frame size and type, so an image may wrap memory owned by the caller.
+class VideoSource
+{
+public:
+   enum class Backend { OpenCV = 0, FFmpeg };
+
+   // NV12 frames are single-channel images with the full-size Y plane on top of the half-size interleaved UV plane.
+   enum class PixelFormat { BGR = 0, NV12 };
+
+   // Cube videos have one video per face. The others cover the whole cube with a single video, which is turned
+   // into a cube atlas. Packed videos have the six faces on two rows of three, where the equi-angular ones sample
+   // each face uniformly in angle rather than in the tangent of it.
+   enum class Projection { Cube = 0, DualFisheye, Packed3x2, EquiAngular3x2 };
+
+   // Without LZ4 the frames are stored raw, 12 MiB for each 2048 x 2048 BGR frame, so the cache holds less by default.
+#ifdef USE_LZ4
+   static constexpr int64_t DefaultCacheSizeLimit = 4LL << 30;
+#else
+   static constexpr int64_t DefaultCacheSizeLimit = 1LL << 30;
+#endif
+
+   struct Settings
+   {
+      PixelFormat Format;
+      Backend Decoder;
+      std::string CacheDirectory; // where decoded frames are kept for the next plays, or empty for no cache
+      int64_t CacheSizeLimit;     // bytes of all the frame stores in CacheDirectory
+      int CacheShareNum;          // the streams recording into CacheDirectory at once, which split CacheSizeLimit
+      Projection InputProjection;
+      int AtlasFaceSize;          // the face size of the cube atlas, or 0 for half the height of the video
+      // The faces of a packed video in reading order, as r, l, u, d, f and b for +x, -x, +y, -y, -z and +z,
+      // and the clockwise quarter turns each of them is stored with. Empty for the usual layout of the projection.
+      std::string PackedFaceOrder;
+      std::string PackedFaceRotation;
+      // BGR frames are block-compressed by the decoding threads and uploaded to compressed textures, which takes
+      // 6 (BC1) or 3 (BC7) times less bandwidth and memory. NV12 frames and sizes that are not multiples of 4 are
+      // not compressed.
+      BlockFormat Compression;
+
+      Settings() :
+         Format( PixelFormat::BGR ), Decoder( Backend::OpenCV ), CacheSizeLimit( DefaultCacheSizeLimit ),
+         CacheShareNum( 1 ), InputProjection( Projection::Cube ), AtlasFaceSize( 0 ), Compression( BlockFormat::None ) {}
+   };
+
+   // The time spent in each stage since the source was created. Sources that wrap another one add its times,
+   // and backends that cannot tell demuxing from decoding count both as decoding.
+   struct StageTimes
+   {
+      double Demux;   // ms
+      double Decode;  // ms
+      double Convert; // ms
+      int64_t FrameNum; // the frames decoded, converted or not
+
+      StageTimes() : Demux( 0.0 ), Decode( 0.0 ), Convert( 0.0 ), FrameNum( 0 ) {}
+      StageTimes& operator+=(const StageTimes& other)
+      {
+         Demux += other.Demux;
+         Decode += other.Decode;
+         Convert += other.Convert;
+         FrameNum += other.FrameNum;
+         return *this;
+      }
+   };
+
+   VideoSource() = default;
+   virtual ~VideoSource() = default;
+
+   [[nodiscard]] static std::unique_ptr<VideoSource> create(const Settings& settings);
+   // NV12 frames only come from decoders that output YUV, which is FFmpeg when it is built in.
+   [[nodiscard]] static bool decodesToNV12(Backend backend);
+   virtual bool open(const std::string& video_path, PixelFormat pixel_format) = 0;
+   virtual void close() = 0;
+   virtual bool read(cv::Mat& image) = 0;
+   virtual bool skip() = 0; // decodes the next frame without converting it
+   virtual bool seek(int64_t frame_index) = 0;
+   // Sources that can find their keyframes without decoding fill them in, and the others return false.
+   virtual bool getKeyframes(std::vector<int64_t>& /*keyframes*/) { return false; }
+   [[nodiscard]] virtual bool isOpened() const = 0;
+   [[nodiscard]] virtual double getFPS() const = 0;
+   [[nodiscard]] virtual cv::Size getFrameSize() const = 0;
+   [[nodiscard]] virtual double getTimestamp() const = 0; // ms of the last read frame, or 0 when it is unknown
+   // It is called from other threads than the decoding one, so the times are kept in atomics.
+   [[nodiscard]] virtual StageTimes getStageTimes() const;
+
+protected:
+   enum class Stage { Demux = 0, Decode, Convert };
+
+   void addStageTime(Stage stage, const std::chrono::steady_clock::time_point& start);
+   void countFrame() { FrameNum++; }
+
+private:
+   std::array<std::atomic<int64_t>, 3> StageTicks{}; // steady_clock ticks
+   std::atomic<int64_t> FrameNum{ 0 };
+};
\ No newline at end of file
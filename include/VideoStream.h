@@ -0,0 +1,114 @@
+#pragma once
+
+#include "PlaybackClock.h"
+#include "FrameDelta.h"
+#include "VideoSource.h"
+#include "KeyframeIndex.h"
+
+class VideoStream
+{
+public:
+   using PixelFormat = VideoSource::PixelFormat;
+
+   struct Frame
+   {
+      cv::Mat Image;
+      cv::Mat Blocks; // the image compressed into 4 x 4 blocks, or empty when the stream is not compressed
+      std::vector<uint8_t> DirtyBlocks; // the blocks that changed since the previous frame taken from the stream
+      double Timestamp;
+      int64_t Index;
+
+      Frame() : Timestamp( 0.0 ), Index( -1 ) {}
+   };
+
+   explicit VideoStream(int ring_size = 3);
+   ~VideoStream();
+
+   bool open(
+      const std::string& video_path,
+      cv::Mat& first_frame,
+      const VideoSource::Settings& settings = VideoSource::Settings()
+   );
+   void play(const PlaybackClock* clock);
+   void close();
+   void setPaused(bool paused);
+   // Decoding restarts at the frame. With keyframe_only, the keyframe before it is shown as the frame, and the
+   // stream holds there until the next seek.
+   void seek(int64_t index, bool keyframe_only);
+   void getDueFrameIndices(std::vector<int64_t>& indices, double time);
+   bool takeFrame(Frame& frame, int64_t index);
+   void dropFramesBefore(int64_t index);
+   [[nodiscard]] int64_t getOldestFrameIndex();
+   [[nodiscard]] int64_t getDecodedFrameIndex() const { return DecodedFrameIndex; }
+   [[nodiscard]] bool isEndOfStream() const { return EndOfStream; }
+   [[nodiscard]] double getFrameDuration() const { return FrameDuration; }
+   [[nodiscard]] bool hasKeyframes() const { return !Keyframes.empty(); }
+   [[nodiscard]] int getDroppedFrameNum() const { return DroppedFrameNum; }
+   [[nodiscard]] int getSkippedFrameNum() const { return SkippedFrameNum; }
+   [[nodiscard]] int getResyncNum() const { return ResyncNum; }
+   [[nodiscard]] double getAverageDecodeTime() const { return AverageDecodeTime; }
+   [[nodiscard]] double getCompressTime() const
+   {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(CompressTicks)).count();
+   }
+   [[nodiscard]] VideoSource::StageTimes getStageTimes() const
+   {
+      return Source != nullptr ? Source->getStageTimes() : VideoSource::StageTimes();
+   }
+   [[nodiscard]] static cv::Size getPictureSize(const cv::Mat& image, PixelFormat pixel_format)
+   {
+      return pixel_format == PixelFormat::NV12 ? cv::Size(image.cols, image.rows * 2 / 3) : image.size();
+   }
+   [[nodiscard]] static BlockFormat getCompression(
+      const cv::Size& picture_size,
+      PixelFormat pixel_format,
+      BlockFormat compression
+   )
+   {
+      return pixel_format == PixelFormat::BGR && BlockCompressor::isCompressible( picture_size )
+         ? compression : BlockFormat::None;
+   }
+
+private:
+   const int RingSize;
+   const double ResyncThreshold; // a resumed stream further behind the clock than this (in ms) seeks instead of decoding
+   int Tail; // the oldest ready frame
+   int ReadyFrameNum;
+   int DroppedFrameNum;
+   std::atomic<int> SkippedFrameNum;
+   std::atomic<int> ResyncNum;
+   int64_t NextFrameIndex;
+   std::atomic<int64_t> DecodedFrameIndex;
+   double FrameDuration;
+   PixelFormat Format;
+   BlockFormat Compression;
+   cv::Size PictureSize;
+   std::atomic<double> AverageDecodeTime; // an exponential moving average in ms per frame
+   std::atomic<int64_t> CompressTicks;    // steady_clock ticks spent block-compressing frames
+   std::atomic<bool> StopDecoding;
+   std::atomic<bool> EndOfStream;
+   std::atomic<bool> Paused;
+   std::atomic<bool> FullFrameRequired;
+   bool Held;
+   bool SeekToKeyframe;
+   int64_t SeekIndex; // the frame the decoder seeks to next, or -1
+   uint64_t Generation; // counts the seeks, to recognize a frame decoded before the last one
+   KeyframeIndex Keyframes;
+   std::vector<Frame> Ring;
+   cv::Mat PreviousImage; // shares the buffer of the last decoded frame
+   std::vector<uint8_t> PassedDirtyBlocks; // the dirty blocks of the frames dropped since the last taken one
+   std::unique_ptr<VideoSource> Source;
+   const PlaybackClock* Clock;
+   std::thread Decoder;
+   std::mutex RingMutex;
+   std::condition_variable SlotFreed;
+
+   [[nodiscard]] double getNextTimestamp() const { return static_cast<double>(NextFrameIndex) * FrameDuration; }
+   bool readFrame(Frame& frame);
+   void updateDirtyBlocks(Frame& frame);
+   void popFrames(int frame_num);
+   void resync();
+   bool seekFrame(Frame& frame, int64_t index, bool keyframe_only);
+   void finishStream(uint64_t generation);
+   void decode();
+};
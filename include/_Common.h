@@ -10,18 +10,29 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <gtx/quaternion.hpp>
+#include <gtx/component_wise.hpp>
 
 #include <opencv2/opencv.hpp>
 #include <FreeImage.h>
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <deque>
+#include <array>
 #include <string>
 #include <map>
 #include <unordered_map>
 #include <sstream>
 #include <fstream>
+#include <filesystem>
 #include <chrono>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <charconv>
 
 #include "ProjectPath.h"
 
@@ -1,8 +1,127 @@
 #include "Renderer.h"
 
-int main()
+// CubeMapping [options]
+// CubeMapping --offline <camera path> <output video> [<width> <height>] [options]
+// The cube shows the static sample faces unless one of these options sets another scene.
+//   --video [<path>]            six face videos in a directory, by default the dynamic samples
+//   --projection <fisheye|3x2|eac> [--face-order <order>] [--face-rotation <turns>]
+//                               a single video covering the whole cube, and the layout of a packed one
+//   --tiles <n>                 a directory of face directories, each with base.avi and n x n tiles
+//   --live <ring name>          the faces another process publishes to a shared frame ring
+//   --cube-map <path>           a cube map file made by CubeMapCompress
+// and these set how the videos are decoded: --ffmpeg, --nv12, --bc1, --bc7 and --frame-cache <directory>, which keeps
+// the decoded frames there for the next plays. --pixel-pool <MiB> limits the released pixel buffers kept for the next
+// images, and --huge-pages backs the large ones with huge pages.
+
+static void printUsage()
+{
+   std::cerr << "Usage: CubeMapping [--offline <camera path> <output video> [<width> <height>]]\n"
+      << "   [--video [<path>]] [--projection <fisheye|3x2|eac>] [--face-order <order>] [--face-rotation <turns>]\n"
+      << "   [--tiles <n>] [--live <ring name>] [--cube-map <path>] [--ffmpeg] [--nv12] [--bc1|--bc7]\n"
+      << "   [--frame-cache <directory>] [--pixel-pool <MiB>] [--huge-pages]\n";
+}
+
+// The whole text should be a number between the bounds.
+static bool parseInteger(const std::string& text, int min_value, int max_value, int& value)
+{
+   int parsed = 0;
+   const char* end = text.data() + text.size();
+   const auto result = std::from_chars( text.data(), end, parsed );
+   if (result.ec != std::errc() || result.ptr != end || parsed < min_value || parsed > max_value) return false;
+   value = parsed;
+   return true;
+}
+
+int main(int argc, char** argv)
 {
+   const std::vector<std::string> arguments(argv + 1, argv + argc);
+   std::vector<std::string> offline_arguments;
+   VideoSource::Settings settings;
+   bool is_video = false;
+   std::string video_path, ring_name, cube_map_path;
+   int tile_num = 0, width = 1920, height = 1080;
+   for (size_t i = 0; i < arguments.size(); ++i) {
+      const std::string& argument = arguments[i];
+      const bool has_value = i + 1 < arguments.size() && arguments[i + 1].rfind( "--", 0 ) != 0;
+      if (argument == "--offline") {
+         for (; i + 1 < arguments.size() && arguments[i + 1].rfind( "--", 0 ) != 0; ++i) {
+            offline_arguments.emplace_back( arguments[i + 1] );
+         }
+         if (offline_arguments.size() != 2 && offline_arguments.size() != 4) {
+            printUsage();
+            return 1;
+         }
+         const int max_size = std::numeric_limits<int>::max();
+         if (offline_arguments.size() == 4 &&
+             (!parseInteger( offline_arguments[2], 1, max_size, width ) ||
+              !parseInteger( offline_arguments[3], 1, max_size, height ))) {
+            std::cerr << "The size of the offline video should be positive numbers\n";
+            printUsage();
+            return 1;
+         }
+      }
+      else if (argument == "--video") {
+         is_video = true;
+         if (has_value) video_path = arguments[++i];
+      }
+      else if (argument == "--projection" && has_value) {
+         const std::string& projection = arguments[++i];
+         if (projection == "fisheye") settings.InputProjection = VideoSource::Projection::DualFisheye;
+         else if (projection == "3x2") settings.InputProjection = VideoSource::Projection::Packed3x2;
+         else if (projection == "eac") settings.InputProjection = VideoSource::Projection::EquiAngular3x2;
+         else {
+            std::cerr << "Unknown projection " << projection.c_str() << "\n";
+            return 1;
+         }
+      }
+      else if (argument == "--face-order" && has_value) settings.PackedFaceOrder = arguments[++i];
+      else if (argument == "--face-rotation" && has_value) settings.PackedFaceRotation = arguments[++i];
+      else if (argument == "--tiles" && has_value) {
+         if (!parseInteger( arguments[++i], 1, 5, tile_num )) {
+            std::cerr << "The number of tiles per side should be between 1 and 5\n";
+            printUsage();
+            return 1;
+         }
+      }
+      else if (argument == "--live" && has_value) ring_name = arguments[++i];
+      else if (argument == "--cube-map" && has_value) cube_map_path = arguments[++i];
+      else if (argument == "--ffmpeg") settings.Decoder = VideoSource::Backend::FFmpeg;
+      else if (argument == "--nv12") settings.Format = VideoSource::PixelFormat::NV12;
+      else if (argument == "--bc1") settings.Compression = BlockFormat::BC1;
+      else if (argument == "--bc7") settings.Compression = BlockFormat::BC7;
+      else if (argument == "--frame-cache" && has_value) settings.CacheDirectory = arguments[++i];
+      else if (argument == "--pixel-pool" && has_value) {
+         int pooled_mib = 0;
+         if (!parseInteger( arguments[++i], 0, std::numeric_limits<int>::max(), pooled_mib )) {
+            printUsage();
+            return 1;
+         }
+         PooledMatAllocator::getInstance()->setPooledByteLimit( static_cast<int64_t>(pooled_mib) << 20 );
+      }
+      else if (argument == "--huge-pages") PooledMatAllocator::getInstance()->setHugePages( true );
+      else {
+         printUsage();
+         return 1;
+      }
+   }
+
+   // The samples are six face videos, so the other layouts need videos of their own.
+   const bool is_packed = settings.InputProjection != VideoSource::Projection::Cube;
+   if ((is_packed || tile_num > 0) && video_path.empty()) {
+      std::cerr << "--projection and --tiles need the path of the videos after --video\n";
+      return 1;
+   }
+
+   // Offline rendering always renders a video, so the decoding options apply to it without --video.
    RendererGL renderer;
+   is_video = is_video || is_packed || tile_num > 0 || !offline_arguments.empty();
+   if (!ring_name.empty()) renderer.setLiveVideo( ring_name );
+   else if (is_video) renderer.setVideo( video_path, settings, tile_num );
+   else if (!cube_map_path.empty()) renderer.setCubeMap( cube_map_path );
+
+   if (!offline_arguments.empty()) {
+      return renderer.renderOffline( offline_arguments[0], offline_arguments[1], width, height ) ? 0 : 1;
+   }
    renderer.play();
    return 0;
-}
\ No newline at end of file
+}
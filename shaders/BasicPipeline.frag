@@ -10,18 +10,84 @@ struct MateralInfo {
 uniform MateralInfo Material;
 
 layout (binding = 0) uniform samplerCube BaseTexture;
+layout (binding = 1) uniform samplerCube DetailTexture;
+layout (binding = 2) uniform samplerCube BaseChromaTexture;
+layout (binding = 3) uniform samplerCube DetailChromaTexture;
 uniform int UseTexture;
+uniform int UsePlanarYUV;
+uniform int UseEquiAngular;
+uniform int TileNum;
+uniform uint ResidentTileMasks[6];
 
 in vec3 tex_coord;
 
 layout (location = 0) out vec4 final_color;
 
+const float zero = 0.0f;
 const float one = 1.0f;
+const float half_one = 0.5f;
+const float four_over_pi = 1.273239545f;
+
+// The face and its (s, t) coordinates are selected as the OpenGL specification does for cube maps.
+void getCubeMapFaceCoordinates(out int face, out vec2 st, in vec3 direction)
+{
+   vec3 magnitude = abs( direction );
+   vec3 coordinates;
+   if (magnitude.x >= magnitude.y && magnitude.x >= magnitude.z) {
+      face = direction.x >= zero ? 0 : 1;
+      coordinates = vec3(direction.x >= zero ? -direction.z : direction.z, -direction.y, magnitude.x);
+   }
+   else if (magnitude.y >= magnitude.z) {
+      face = direction.y >= zero ? 2 : 3;
+      coordinates = vec3(direction.x, direction.y >= zero ? direction.z : -direction.z, magnitude.y);
+   }
+   else {
+      face = direction.z >= zero ? 4 : 5;
+      coordinates = vec3(direction.z >= zero ? direction.x : -direction.x, -direction.y, magnitude.z);
+   }
+   st = half_one * (coordinates.xy / coordinates.z + one);
+}
+
+bool isTileResident()
+{
+   int face;
+   vec2 st;
+   getCubeMapFaceCoordinates( face, st, tex_coord );
+   ivec2 tile = clamp( ivec2(st * float(TileNum)), ivec2(0), ivec2(TileNum - 1) );
+   return (ResidentTileMasks[face] & (1u << uint(tile.y * TileNum + tile.x))) != 0u;
+}
+
+// An equi-angular face has its texels evenly spaced in the angle from the center, so the tangent of the angle is
+// replaced by the angle itself. On the major axis, the tangent is 1 and stays 1.
+vec3 getVideoDirection()
+{
+   if (UseEquiAngular == 0) return tex_coord;
+
+   vec3 magnitude = abs( tex_coord );
+   return four_over_pi * atan( tex_coord / max( magnitude.x, max( magnitude.y, magnitude.z ) ) );
+}
+
+// NV12 video keeps Y in the first texture and UV in the chroma one, coded in limited-range BT.601.
+vec4 getVideoColor(in samplerCube luma_texture, in samplerCube chroma_texture)
+{
+   vec3 direction = getVideoDirection();
+   if (UsePlanarYUV == 0) return texture( luma_texture, direction );
+
+   float y = 1.164f * (texture( luma_texture, direction ).r - 16.0f / 255.0f);
+   vec2 uv = texture( chroma_texture, direction ).rg - half_one;
+   return vec4(
+      y + 1.596f * uv.y,
+      y - 0.392f * uv.x - 0.813f * uv.y,
+      y + 2.017f * uv.x,
+      one
+   );
+}
 
 void main()
 {
    if (UseTexture == 0) final_color = vec4(one);
-   else final_color = texture( BaseTexture, tex_coord );
+   else if (TileNum > 0 && isTileResident()) final_color = getVideoColor( DetailTexture, DetailChromaTexture );
+   else final_color = getVideoColor( BaseTexture, BaseChromaTexture );
 
    final_color *= Material.DiffuseColor;
 }
\ No newline at end of file
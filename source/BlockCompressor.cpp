@@ -0,0 +1,274 @@
+#include "BlockCompressor.h"
+
+void BlockCompressor::getDiagonalEndpoints(
+   const BlockPixels& pixels,
+   std::array<int, 3>& first,
+   std::array<int, 3>& last
+)
+{
+   std::array<int, 3> min_color{ 255, 255, 255 }, max_color{ 0, 0, 0 }, sum{ 0, 0, 0 };
+   for (const auto& pixel : pixels) {
+      for (int c = 0; c < 3; ++c) {
+         min_color[c] = std::min( min_color[c], pixel[c] );
+         max_color[c] = std::max( max_color[c], pixel[c] );
+         sum[c] += pixel[c];
+      }
+   }
+
+   // The channel with the widest range leads, and a channel that falls while it rises runs the other way along the
+   // box. The box is inset by a sixteenth of its range, because the extremes are rarely worth an endpoint of their own.
+   int lead = 0;
+   for (int c = 1; c < 3; ++c) {
+      if (max_color[c] - min_color[c] > max_color[lead] - min_color[lead]) lead = c;
+   }
+   for (int c = 0; c < 3; ++c) {
+      int covariance = 0;
+      for (const auto& pixel : pixels) covariance += (pixel[lead] * 16 - sum[lead]) * (pixel[c] * 16 - sum[c]);
+      const int inset = (max_color[c] - min_color[c]) >> 4;
+      const int low = min_color[c] + inset;
+      const int high = max_color[c] - inset;
+      first[c] = covariance < 0 ? high : low;
+      last[c] = covariance < 0 ? low : high;
+   }
+}
+
+void BlockCompressor::getIndices(
+   const BlockPixels& pixels,
+   const std::array<int, 3>& first,
+   const std::array<int, 3>& last,
+   int level_num,
+   std::array<int, 16>& indices
+)
+{
+   // Each pixel takes the level nearest to its projection onto the line between the decoded endpoints.
+   const std::array<int, 3> direction{ last[0] - first[0], last[1] - first[1], last[2] - first[2] };
+   const int length = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+   for (int i = 0; i < 16; ++i) {
+      if (length == 0) {
+         indices[i] = 0;
+         continue;
+      }
+      int projection = 0;
+      for (int c = 0; c < 3; ++c) projection += (pixels[i][c] - first[c]) * direction[c];
+      const int level = (2 * projection * (level_num - 1) + length) / (2 * length);
+      indices[i] = projection <= 0 ? 0 : std::min( level, level_num - 1 );
+   }
+}
+
+void BlockCompressor::compressBC1Block(const BlockPixels& pixels, uint8_t* block)
+{
+   const auto to565 = [](const std::array<int, 3>& color) {
+      return static_cast<uint16_t>(
+         ((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | (color[2] * 31 + 127) / 255
+      );
+   };
+   const auto from565 = [](uint16_t color) {
+      const int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+      return std::array<int, 3>{ r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2 };
+   };
+
+   std::array<int, 3> first{}, last{};
+   getDiagonalEndpoints( pixels, first, last );
+   uint16_t color0 = to565( first );
+   uint16_t color1 = to565( last );
+
+   // The first color has to be the greater one for the four-color mode. Equal colors decode to the first color.
+   uint32_t bits = 0;
+   if (color0 != color1) {
+      if (color0 < color1) std::swap( color0, color1 );
+      std::array<int, 16> indices{};
+      getIndices( pixels, from565( color0 ), from565( color1 ), 4, indices );
+      constexpr std::array<uint32_t, 4> order{ 0, 2, 3, 1 }; // color0, 2/3 color0 + 1/3 color1, ..., color1
+      for (int i = 0; i < 16; ++i) bits |= order[indices[i]] << (2 * i);
+   }
+   block[0] = static_cast<uint8_t>(color0 & 0xFF);
+   block[1] = static_cast<uint8_t>(color0 >> 8);
+   block[2] = static_cast<uint8_t>(color1 & 0xFF);
+   block[3] = static_cast<uint8_t>(color1 >> 8);
+   for (int i = 0; i < 4; ++i) block[4 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+void BlockCompressor::compressAlphaBlock(const std::array<int, 16>& alphas, uint8_t* block)
+{
+   // With the first alpha above the second, the indices 0 and 1 are the endpoints and 2 to 7 the six levels between
+   // them, from the first to the second. Equal alphas decode to the first one.
+   const int alpha0 = *std::max_element( alphas.begin(), alphas.end() );
+   const int alpha1 = *std::min_element( alphas.begin(), alphas.end() );
+   uint64_t bits = 0;
+   if (alpha0 > alpha1) {
+      const int range = alpha0 - alpha1;
+      for (int i = 0; i < 16; ++i) {
+         const int level = ((alpha0 - alphas[i]) * 7 + range / 2) / range;
+         const uint64_t index = level == 0 ? 0 : level == 7 ? 1 : level + 1;
+         bits |= index << (3 * i);
+      }
+   }
+   block[0] = static_cast<uint8_t>(alpha0);
+   block[1] = static_cast<uint8_t>(alpha1);
+   for (int i = 0; i < 6; ++i) block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+void BlockCompressor::compressBC7Block(const BlockPixels& pixels, uint8_t* block)
+{
+   // Mode 6 keeps 7 bits per endpoint channel and a p-bit per endpoint. The p-bits are set so that the alpha is 255,
+   // which makes every decoded endpoint channel odd.
+   std::array<int, 3> first{}, last{};
+   getDiagonalEndpoints( pixels, first, last );
+   std::array<int, 3> first7{}, last7{};
+   for (int c = 0; c < 3; ++c) {
+      first7[c] = first[c] >> 1;
+      last7[c] = last[c] >> 1;
+      first[c] = first7[c] << 1 | 1;
+      last[c] = last7[c] << 1 | 1;
+   }
+   std::array<int, 16> indices{};
+   getIndices( pixels, first, last, 16, indices );
+
+   // The most significant index bit of the first pixel is implied to be 0.
+   if (indices[0] >= 8) {
+      std::swap( first7, last7 );
+      for (auto& index : indices) index = 15 - index;
+   }
+
+   std::array<uint64_t, 2> bits{ 0, 0 };
+   int position = 0;
+   const auto put = [&](uint64_t value, int bit_num) {
+      for (int i = 0; i < bit_num; ++i, ++position) {
+         if ((value >> i) & 1) bits[position >> 6] |= 1ULL << (position & 63);
+      }
+   };
+   put( 1 << 6, 7 );
+   for (int c = 0; c < 3; ++c) {
+      put( first7[c], 7 );
+      put( last7[c], 7 );
+   }
+   put( 127, 7 );
+   put( 127, 7 );
+   put( 1, 1 );
+   put( 1, 1 );
+   put( indices[0], 3 );
+   for (int i = 1; i < 16; ++i) put( indices[i], 4 );
+   for (int i = 0; i < 16; ++i) block[i] = static_cast<uint8_t>(bits[i >> 3] >> (8 * (i & 7)));
+}
+
+void BlockCompressor::decompressBC1Block(const uint8_t* block, BlockPixels& pixels)
+{
+   const auto color0 = static_cast<uint16_t>(block[0] | block[1] << 8);
+   const auto color1 = static_cast<uint16_t>(block[2] | block[3] << 8);
+   std::array<std::array<int, 3>, 4> palette{};
+   for (int i = 0; i < 2; ++i) {
+      const uint16_t color = i == 0 ? color0 : color1;
+      const int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+      palette[i] = { r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2 };
+   }
+   for (int c = 0; c < 3; ++c) {
+      if (color0 > color1) {
+         palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+         palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      }
+      else {
+         palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+         palette[3][c] = 0;
+      }
+   }
+   const auto bits = static_cast<uint32_t>(block[4] | block[5] << 8 | block[6] << 16 | block[7] << 24);
+   for (int i = 0; i < 16; ++i) pixels[i] = palette[(bits >> (2 * i)) & 3];
+}
+
+void BlockCompressor::decompressBC7Block(const uint8_t* block, BlockPixels& pixels)
+{
+   std::array<uint64_t, 2> bits{ 0, 0 };
+   for (int i = 0; i < 16; ++i) bits[i >> 3] |= static_cast<uint64_t>(block[i]) << (8 * (i & 7));
+   int position = 7;
+   const auto get = [&](int bit_num) {
+      int value = 0;
+      for (int i = 0; i < bit_num; ++i, ++position) {
+         value |= static_cast<int>((bits[position >> 6] >> (position & 63)) & 1) << i;
+      }
+      return value;
+   };
+   std::array<int, 3> first{}, last{};
+   for (int c = 0; c < 3; ++c) {
+      first[c] = get( 7 ) << 1;
+      last[c] = get( 7 ) << 1;
+   }
+   get( 14 ); // alpha
+   const int first_p = get( 1 );
+   const int last_p = get( 1 );
+   constexpr std::array<int, 16> weights{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+   for (int i = 0; i < 16; ++i) {
+      const int weight = weights[get( i == 0 ? 3 : 4 )];
+      for (int c = 0; c < 3; ++c) {
+         pixels[i][c] = ((64 - weight) * (first[c] | first_p) + weight * (last[c] | last_p) + 32) >> 6;
+      }
+   }
+}
+
+void BlockCompressor::compress(const cv::Mat& image, BlockFormat format, cv::Mat& blocks)
+{
+   CV_Assert(
+      (image.type() == CV_8UC3 || image.type() == CV_8UC4) && isCompressible( image.size() ) &&
+      format != BlockFormat::None
+   );
+
+   blocks.create( getBlockImageSize( image.size(), format ), CV_8UC1 );
+   const int block_bytes = getBlockBytes( format );
+   const int channels = image.channels();
+   cv::parallel_for_(
+      cv::Range(0, blocks.rows),
+      [&](const cv::Range& range) {
+         BlockPixels pixels{};
+         std::array<int, 16> alphas{};
+         alphas.fill( 255 );
+         for (int by = range.start; by < range.end; ++by) {
+            uint8_t* block = blocks.ptr<uint8_t>( by );
+            for (int bx = 0; bx < image.cols / 4; ++bx, block += block_bytes) {
+               for (int y = 0; y < 4; ++y) {
+                  const uint8_t* row = image.ptr<uint8_t>( by * 4 + y, bx * 4 );
+                  for (int x = 0; x < 4; ++x, row += channels) {
+                     pixels[y * 4 + x] = { row[2], row[1], row[0] };
+                     if (channels == 4) alphas[y * 4 + x] = row[3];
+                  }
+               }
+               if (format == BlockFormat::BC1) compressBC1Block( pixels, block );
+               else if (format == BlockFormat::BC3) {
+                  compressAlphaBlock( alphas, block );
+                  compressBC1Block( pixels, block + 8 );
+               }
+               else compressBC7Block( pixels, block );
+            }
+         }
+      }
+   );
+}
+
+void BlockCompressor::decompress(const cv::Mat& blocks, BlockFormat format, const cv::Size& size, cv::Mat& bgr)
+{
+   CV_Assert( isCompressible( size ) && blocks.size() == getBlockImageSize( size, format ) );
+
+   bgr.create( size, CV_8UC3 );
+   const int block_bytes = getBlockBytes( format );
+   cv::parallel_for_(
+      cv::Range(0, blocks.rows),
+      [&](const cv::Range& range) {
+         BlockPixels pixels{};
+         for (int by = range.start; by < range.end; ++by) {
+            const uint8_t* block = blocks.ptr<uint8_t>( by );
+            for (int bx = 0; bx < size.width / 4; ++bx, block += block_bytes) {
+               if (format == BlockFormat::BC1) decompressBC1Block( block, pixels );
+               else if (format == BlockFormat::BC3) decompressBC1Block( block + 8, pixels );
+               else decompressBC7Block( block, pixels );
+               for (int y = 0; y < 4; ++y) {
+                  uint8_t* row = bgr.ptr<uint8_t>( by * 4 + y, bx * 4 );
+                  for (int x = 0; x < 4; ++x) {
+                     const auto& pixel = pixels[y * 4 + x];
+                     row[x * 3] = static_cast<uint8_t>(pixel[2]);
+                     row[x * 3 + 1] = static_cast<uint8_t>(pixel[1]);
+                     row[x * 3 + 2] = static_cast<uint8_t>(pixel[0]);
+                  }
+               }
+            }
+         }
+      }
+   );
+}
@@ -0,0 +1,135 @@
+#include "CachedVideoSource.h"
+
+CachedVideoSource::CachedVideoSource(
+   std::unique_ptr<VideoSource> decoder,
+   std::string cache_directory,
+   int64_t cache_size_limit,
+   int cache_share_num
+) :
+   CacheDirectory( std::move( cache_directory ) ), CacheSizeLimit( cache_size_limit ),
+   StoreSizeLimit( cache_size_limit / cache_share_num ), DirectoryCheckInterval( 64LL << 20 ),
+   NextDirectoryCheck( 0 ), Cached( false ), Recording( false ), Format( PixelFormat::BGR ), NextFrameIndex( 0 ),
+   Timestamp( 0.0 ), Decoder( std::move( decoder ) )
+{
+}
+
+CachedVideoSource::~CachedVideoSource()
+{
+   close();
+}
+
+bool CachedVideoSource::open(const std::string& video_path, PixelFormat pixel_format)
+{
+   close();
+   Format = pixel_format;
+   NextFrameIndex = 0;
+   Timestamp = 0.0;
+   const FrameStore::SourceStamp stamp = FrameStore::getSourceStamp( video_path );
+   StorePath = FrameStore::getStorePath( CacheDirectory, video_path, static_cast<int>(pixel_format) );
+   if (Store.openForReading( StorePath, stamp )) {
+      Cached = true;
+      return true;
+   }
+
+   if (!Decoder->open( video_path, pixel_format )) return false;
+   Recording = Store.beginWriting( StorePath, stamp, Decoder->getFPS() );
+   NextDirectoryCheck = 0;
+   return true;
+}
+
+void CachedVideoSource::close()
+{
+   stopRecording( false );
+   Store.close();
+   Decoder->close();
+   Cached = false;
+}
+
+void CachedVideoSource::stopRecording(bool complete)
+{
+   if (!Recording) return;
+
+   Recording = false;
+   if (complete && Store.finishWriting()) FrameStore::enforceSizeLimit( CacheDirectory, CacheSizeLimit, StorePath );
+   else Store.abortWriting();
+}
+
+bool CachedVideoSource::fitsSizeLimit(const cv::Mat& image)
+{
+   const auto written_bytes = Store.getWrittenBytes() + static_cast<int64_t>(image.total() * image.elemSize());
+   if (written_bytes > StoreSizeLimit) return false;
+   if (written_bytes < NextDirectoryCheck) return true;
+
+   // The least recently used stores make room for the recordings, which are never evicted themselves.
+   NextDirectoryCheck = written_bytes + DirectoryCheckInterval;
+   return FrameStore::enforceSizeLimit( CacheDirectory, CacheSizeLimit, StorePath ) <= CacheSizeLimit;
+}
+
+cv::Size CachedVideoSource::getFrameSize() const
+{
+   if (!Cached) return Decoder->getFrameSize();
+
+   const cv::Size size = Store.getFrameSize();
+   return Format == PixelFormat::NV12 ? cv::Size(size.width, size.height * 2 / 3) : size;
+}
+
+bool CachedVideoSource::read(cv::Mat& image)
+{
+   if (Cached) {
+      // Reading a stored frame stands in for decoding it.
+      const auto start = std::chrono::steady_clock::now();
+      if (!Store.readFrame( image, NextFrameIndex )) return false;
+      addStageTime( Stage::Decode, start );
+      countFrame();
+      Timestamp = Store.getTimestamp( NextFrameIndex++ );
+      return true;
+   }
+
+   if (!Decoder->read( image )) {
+      // Only a play that went through every frame in order leaves a usable store.
+      stopRecording( true );
+      return false;
+   }
+   if (Recording) {
+      if (!fitsSizeLimit( image ) || !Store.writeFrame( image, Decoder->getTimestamp() )) stopRecording( false );
+   }
+   return true;
+}
+
+bool CachedVideoSource::skip()
+{
+   if (Cached) {
+      if (NextFrameIndex >= Store.getFrameNum()) return false;
+      Timestamp = Store.getTimestamp( NextFrameIndex++ );
+      return true;
+   }
+
+   // While recording, a skipped frame is still converted so that the store has every frame.
+   if (Recording) return read( SkippedImage );
+   return Decoder->skip();
+}
+
+bool CachedVideoSource::seek(int64_t frame_index)
+{
+   if (Cached) {
+      if (frame_index < 0 || frame_index >= Store.getFrameNum()) return false;
+      NextFrameIndex = frame_index;
+      return true;
+   }
+
+   stopRecording( false );
+   return Decoder->seek( frame_index );
+}
+
+bool CachedVideoSource::getKeyframes(std::vector<int64_t>& keyframes)
+{
+   // Every frame of a store can be read directly.
+   return !Cached && Decoder->getKeyframes( keyframes );
+}
+
+VideoSource::StageTimes CachedVideoSource::getStageTimes() const
+{
+   StageTimes times = VideoSource::getStageTimes();
+   times += Decoder->getStageTimes();
+   return times;
+}
\ No newline at end of file
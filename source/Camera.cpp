@@ -32,6 +32,22 @@ void CameraGL::updateCamera()
    CamPos.z = inverse_view[3][2];
 }
 
+void CameraGL::setView(
+   const glm::vec3& cam_position,
+   const glm::vec3& view_reference_position,
+   const glm::vec3& view_up_vector
+)
+{
+   CamPos = cam_position;
+   ViewMatrix = lookAt( cam_position, view_reference_position, view_up_vector );
+}
+
+void CameraGL::setFOV(float fov)
+{
+   FOV = fov;
+   ProjectionMatrix = glm::perspective( glm::radians( FOV ), AspectRatio, NearPlane, FarPlane );
+}
+
 void CameraGL::pitch(int angle)
 {
    const glm::vec3 u_axis(ViewMatrix[0][0], ViewMatrix[1][0], ViewMatrix[2][0]);
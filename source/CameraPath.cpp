@@ -0,0 +1,54 @@
+#include "CameraPath.h"
+
+bool CameraPath::load(const std::string& path)
+{
+   Keyframes.clear();
+   std::ifstream file(path);
+   if (!file.is_open()) {
+      std::cerr << "Could not open the camera path " << path.c_str() << "\n";
+      return false;
+   }
+
+   std::string line;
+   while (std::getline( file, line )) {
+      if (line.empty() || line[0] == '#') continue;
+
+      std::istringstream stream(line);
+      Keyframe keyframe{};
+      stream >> keyframe.Time
+         >> keyframe.Position.x >> keyframe.Position.y >> keyframe.Position.z
+         >> keyframe.Reference.x >> keyframe.Reference.y >> keyframe.Reference.z
+         >> keyframe.FOV;
+      if (stream.fail()) {
+         std::cerr << "Could not read the camera keyframe: " << line.c_str() << "\n";
+         Keyframes.clear();
+         return false;
+      }
+      Keyframes.emplace_back( keyframe );
+   }
+   std::stable_sort(
+      Keyframes.begin(), Keyframes.end(),
+      [](const Keyframe& a, const Keyframe& b) { return a.Time < b.Time; }
+   );
+   return !Keyframes.empty();
+}
+
+void CameraPath::apply(CameraGL* camera, double time) const
+{
+   if (Keyframes.empty()) return;
+
+   const auto next = std::upper_bound(
+      Keyframes.begin(), Keyframes.end(), time,
+      [](double t, const Keyframe& keyframe) { return t < keyframe.Time; }
+   );
+   const Keyframe& from = next == Keyframes.begin() ? *next : *(next - 1);
+   const Keyframe& to = next == Keyframes.end() ? from : *next;
+   const double interval = to.Time - from.Time;
+   const auto t = static_cast<float>(interval > 0.0 ? (time - from.Time) / interval : 0.0);
+   camera->setView(
+      glm::mix( from.Position, to.Position, t ),
+      glm::mix( from.Reference, to.Reference, t ),
+      glm::vec3(0.0f, 1.0f, 0.0f)
+   );
+   camera->setFOV( glm::mix( from.FOV, to.FOV, t ) );
+}
\ No newline at end of file
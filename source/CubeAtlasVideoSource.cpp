@@ -0,0 +1,195 @@
+#include "CubeAtlasVideoSource.h"
+
+CubeAtlasVideoSource::CubeAtlasVideoSource(std::unique_ptr<VideoSource> decoder, const Settings& settings) :
+   InputProjection( settings.InputProjection ), RequestedFaceSize( settings.AtlasFaceSize ),
+   FaceOrder( settings.PackedFaceOrder ), FaceRotation( settings.PackedFaceRotation ), Format( PixelFormat::BGR ),
+   FaceSize( 0 ), Resampled( true ), Rearranged( false ), PackedFaces{}, PackedQuarterTurns{},
+   Decoder( std::move( decoder ) )
+{
+   // The usual layouts are the one of ffmpeg's c3x2 for cube maps and the one of YouTube for equi-angular ones.
+   if (FaceOrder.empty()) FaceOrder = InputProjection == Projection::EquiAngular3x2 ? "lfrdbu" : "rludfb";
+   if (FaceRotation.empty()) FaceRotation = InputProjection == Projection::EquiAngular3x2 ? "000313" : "000000";
+}
+
+bool CubeAtlasVideoSource::loadFisheyeLenses(const std::string& video_path, std::array<FisheyeLens, 2>& lenses)
+{
+   const std::string calibration_path = video_path + ".fisheye";
+   std::ifstream file(calibration_path);
+   if (!file.is_open()) {
+      std::cerr << "Could not open the fisheye calibration " << calibration_path.c_str() << "\n";
+      return false;
+   }
+
+   for (auto& lens : lenses) {
+      float fov, yaw, pitch, roll;
+      if (!(file >> lens.Center.x >> lens.Center.y >> lens.Radius >> fov >> yaw >> pitch >> roll)) {
+         std::cerr << "The fisheye calibration " << calibration_path.c_str() << " should have two lenses\n";
+         return false;
+      }
+      lens.HalfFOV = glm::radians( fov ) * 0.5f;
+      const glm::mat4 rotation =
+         glm::rotate( glm::mat4(1.0f), glm::radians( yaw ), glm::vec3(0.0f, 1.0f, 0.0f) ) *
+         glm::rotate( glm::mat4(1.0f), glm::radians( pitch ), glm::vec3(1.0f, 0.0f, 0.0f) ) *
+         glm::rotate( glm::mat4(1.0f), glm::radians( roll ), glm::vec3(0.0f, 0.0f, 1.0f) );
+      lens.Rotation = glm::mat3(rotation);
+   }
+   return true;
+}
+
+bool CubeAtlasVideoSource::projectToFisheye(
+   const std::array<FisheyeLens, 2>& lenses,
+   const glm::vec3& direction,
+   glm::vec2& position
+)
+{
+   // A direction seen by both lenses is taken from the one that has it closer to its center.
+   const FisheyeLens* best = nullptr;
+   glm::vec3 best_local;
+   float best_ratio = 1.0f;
+   for (const auto& lens : lenses) {
+      const glm::vec3 local = glm::transpose( lens.Rotation ) * direction;
+      const float theta = std::acos( glm::clamp( local.z, -1.0f, 1.0f ) );
+      const float ratio = theta / lens.HalfFOV;
+      if (ratio <= best_ratio) {
+         best = &lens;
+         best_local = local;
+         best_ratio = ratio;
+      }
+   }
+   if (best == nullptr) return false;
+
+   // Looking along +z with +y up, +x is on the left of the picture.
+   const float rho = std::sqrt( best_local.x * best_local.x + best_local.y * best_local.y );
+   const float r = best_ratio * best->Radius;
+   position = rho > 0.0f ? best->Center + r * glm::vec2(-best_local.x, -best_local.y) / rho : best->Center;
+   return true;
+}
+
+bool CubeAtlasVideoSource::preparePacking(const std::string& video_path)
+{
+   const cv::Size source_size = Decoder->getFrameSize();
+   FaceSize = source_size.width / 3;
+   if (source_size.width != FaceSize * 3 || source_size.height != FaceSize * 2) {
+      std::cerr << video_path.c_str() << " is " << source_size.width << "x" << source_size.height
+         << ", which is not a 3x2 layout of square faces\n";
+      return false;
+   }
+   if (Format == PixelFormat::NV12 && FaceSize % 2 != 0) {
+      std::cerr << "NV12 faces need an even size, but the faces of " << video_path.c_str() << " are " << FaceSize
+         << "\n";
+      return false;
+   }
+
+   const std::string face_letters = "rludbf";
+   std::array<bool, 6> placed{};
+   for (size_t i = 0; i < 6; ++i) {
+      const size_t face = i < FaceOrder.size() ? face_letters.find( FaceOrder[i] ) : std::string::npos;
+      const int quarter_turns = i < FaceRotation.size() ? FaceRotation[i] - '0' : -1;
+      if (face == std::string::npos || placed[face] || quarter_turns < 0 || quarter_turns > 3) {
+         std::cerr << "The packed face order " << FaceOrder.c_str() << " or the rotation " << FaceRotation.c_str()
+            << " is not valid\n";
+         return false;
+      }
+      placed[face] = true;
+      PackedFaces[i] = static_cast<int>(face);
+      PackedQuarterTurns[i] = quarter_turns;
+   }
+
+   // Faces already in the order of the atlas are decoded straight into it.
+   Rearranged = false;
+   for (int i = 0; i < 6; ++i) {
+      if (PackedFaces[i] != i || PackedQuarterTurns[i] != 0) Rearranged = true;
+   }
+   return true;
+}
+
+void CubeAtlasVideoSource::rearrangeFaces(const cv::Mat& source, cv::Mat& atlas) const
+{
+   const auto move_faces = [this](const cv::Mat& from, cv::Mat& to, int face_size) {
+      for (int i = 0; i < 6; ++i) {
+         const cv::Mat packed = from( CubeFaceRemap::getFaceArea( i, face_size ) );
+         cv::Mat face = to( CubeFaceRemap::getFaceArea( PackedFaces[i], face_size ) );
+         switch (PackedQuarterTurns[i]) {
+            case 1: cv::rotate( packed, face, cv::ROTATE_90_COUNTERCLOCKWISE ); break;
+            case 2: cv::rotate( packed, face, cv::ROTATE_180 ); break;
+            case 3: cv::rotate( packed, face, cv::ROTATE_90_CLOCKWISE ); break;
+            default: packed.copyTo( face ); break;
+         }
+      }
+   };
+
+   const cv::Size atlas_size = CubeFaceRemap::getAtlasSize( FaceSize );
+   if (Format == PixelFormat::BGR) {
+      atlas.create( atlas_size, CV_8UC3 );
+      move_faces( source, atlas, FaceSize );
+      return;
+   }
+
+   atlas.create( atlas_size.height * 3 / 2, atlas_size.width, CV_8UC1 );
+   cv::Mat luma = atlas.rowRange( 0, atlas_size.height );
+   cv::Mat chroma(atlas_size.height / 2, atlas_size.width / 2, CV_8UC2, atlas.ptr<uint8_t>( atlas_size.height ));
+   const cv::Mat source_chroma(
+      atlas_size.height / 2, atlas_size.width / 2, CV_8UC2,
+      const_cast<uint8_t*>(source.ptr<uint8_t>( atlas_size.height ))
+   );
+   move_faces( source.rowRange( 0, atlas_size.height ), luma, FaceSize );
+   move_faces( source_chroma, chroma, FaceSize / 2 );
+}
+
+bool CubeAtlasVideoSource::open(const std::string& video_path, PixelFormat pixel_format)
+{
+   if (!Decoder->open( video_path, pixel_format )) return false;
+
+   Format = pixel_format;
+   Resampled = InputProjection == Projection::DualFisheye;
+   if (!Resampled) {
+      if (preparePacking( video_path )) return true;
+      Decoder->close();
+      return false;
+   }
+
+   const cv::Size source_size = Decoder->getFrameSize();
+   int face_size = RequestedFaceSize > 0 ? RequestedFaceSize : source_size.height / 2;
+   if (Format == PixelFormat::NV12) face_size &= ~1;
+   FaceSize = face_size;
+
+   switch (InputProjection) {
+      case Projection::DualFisheye: {
+         std::array<FisheyeLens, 2> lenses{};
+         if (!loadFisheyeLenses( video_path, lenses )) {
+            Decoder->close();
+            return false;
+         }
+         Remap.build(
+            [&lenses](const glm::vec3& direction, glm::vec2& position) {
+               return projectToFisheye( lenses, direction, position );
+            },
+            face_size, Format
+         );
+      } break;
+      default:
+         std::cerr << "The projection of " << video_path.c_str() << " cannot be resampled into a cube atlas\n";
+         Decoder->close();
+         return false;
+   }
+   return true;
+}
+
+bool CubeAtlasVideoSource::read(cv::Mat& image)
+{
+   if (!Resampled && !Rearranged) return Decoder->read( image );
+   if (!Decoder->read( SourceImage )) return false;
+
+   const auto start = std::chrono::steady_clock::now();
+   if (Resampled) Remap.apply( SourceImage, image, Format );
+   else rearrangeFaces( SourceImage, image );
+   addStageTime( Stage::Convert, start );
+   return true;
+}
+
+VideoSource::StageTimes CubeAtlasVideoSource::getStageTimes() const
+{
+   StageTimes times = VideoSource::getStageTimes();
+   times += Decoder->getStageTimes();
+   return times;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "CubeFaceLoader.h"
+
+CubeFaceLoader::CubeFaceLoader() : ReadFlags( cv::IMREAD_COLOR ), TakenFaceNum( 0 ), NextFace( 0 )
+{
+}
+
+CubeFaceLoader::~CubeFaceLoader()
+{
+   stop();
+}
+
+cv::Size CubeFaceLoader::getJPEGSize(const std::string& image_path)
+{
+   MappedFile image;
+   if (!image.open( image_path )) return {};
+
+   // The segments are skipped by their lengths until a start of frame, which is any of 0xC0 to 0xCF but the
+   // Huffman table 0xC4, the JPG extension 0xC8 and the arithmetic coding table 0xCC.
+   const uint8_t* data = image.getData();
+   const size_t size = image.getSize();
+   if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return {};
+   size_t position = 2;
+   while (position + 4 <= size) {
+      if (data[position] != 0xFF) return {};
+      const uint8_t marker = data[position + 1];
+      if (marker == 0xFF) {
+         position++;
+         continue;
+      }
+      const size_t length = static_cast<size_t>(data[position + 2]) << 8 | data[position + 3];
+      if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+         if (length < 7 || position + 2 + length > size) return {};
+         const int height = data[position + 5] << 8 | data[position + 6];
+         const int width = data[position + 7] << 8 | data[position + 8];
+         return { width, height };
+      }
+      if (marker == 0xD9 || marker == 0xDA || length < 2) return {};
+      position += 2 + length;
+   }
+   return {};
+}
+
+void CubeFaceLoader::start(const std::vector<std::string>& image_paths, int read_flags)
+{
+   stop();
+   ReadFlags = read_flags;
+   ImagePaths = image_paths;
+   Images.assign( ImagePaths.size(), cv::Mat() );
+   Times.assign( ImagePaths.size(), FaceTimes() );
+   DecodedFaces.clear();
+   TakenFaceNum = 0;
+   NextFace = 0;
+   StartTime = std::chrono::steady_clock::now();
+
+   // A decoder takes the next face as soon as it is done with one, so a slow face does not hold the others up.
+   const auto hardware_thread_num = static_cast<int>(std::thread::hardware_concurrency());
+   const int decoder_num = std::min( getFaceNum(), std::max( hardware_thread_num, 1 ) );
+   for (int i = 0; i < decoder_num; ++i) Decoders.emplace_back( &CubeFaceLoader::decode, this );
+}
+
+void CubeFaceLoader::decode()
+{
+   for (int face = NextFace++; face < getFaceNum(); face = NextFace++) {
+      const auto start = std::chrono::steady_clock::now();
+      cv::Mat image = cv::imread( ImagePaths[face], ReadFlags );
+      const auto end = std::chrono::steady_clock::now();
+
+      std::lock_guard<std::mutex> lock(Mutex);
+      Images[face] = std::move( image );
+      Times[face].Decode = std::chrono::duration<double, std::milli>(end - start).count();
+      Times[face].Ready = std::chrono::duration<double, std::milli>(end - StartTime).count();
+      DecodedFaces.emplace_back( face );
+      FaceDecoded.notify_one();
+   }
+}
+
+bool CubeFaceLoader::takeFace(int& face, cv::Mat& image)
+{
+   std::unique_lock<std::mutex> lock(Mutex);
+   if (TakenFaceNum >= getFaceNum()) return false;
+
+   FaceDecoded.wait( lock, [this]() { return !DecodedFaces.empty(); } );
+   face = DecodedFaces.front();
+   DecodedFaces.pop_front();
+   image = std::move( Images[face] );
+   Images[face].release();
+   TakenFaceNum++;
+   return true;
+}
+
+void CubeFaceLoader::stop()
+{
+   // The decoders are not interrupted, because a face being decoded cannot be, but the faces left are not started.
+   NextFace = getFaceNum();
+   for (auto& decoder : Decoders) {
+      if (decoder.joinable()) decoder.join();
+   }
+   Decoders.clear();
+}
+
+CubeFaceLoader::FaceTimes CubeFaceLoader::getFaceTimes(int face)
+{
+   std::lock_guard<std::mutex> lock(Mutex);
+   return Times[face];
+}
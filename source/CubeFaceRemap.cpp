@@ -0,0 +1,91 @@
+#include "CubeFaceRemap.h"
+
+void CubeFaceRemap::buildMaps(const Projection& projection, int face_size, float scale, std::array<cv::Mat, 2>& maps)
+{
+   // The maps are built in the coordinates of a plane that is scale times the size of the luma plane.
+   const auto scaled_face_size = static_cast<int>(static_cast<float>(face_size) * scale);
+   cv::Mat map_x(getAtlasSize( scaled_face_size ), CV_32FC1);
+   cv::Mat map_y(getAtlasSize( scaled_face_size ), CV_32FC1);
+   cv::parallel_for_(
+      cv::Range(0, 6 * scaled_face_size),
+      [&](const cv::Range& range) {
+         for (int r = range.start; r < range.end; ++r) {
+            const int face = r / scaled_face_size;
+            const int y = r % scaled_face_size;
+            const cv::Rect area = getFaceArea( face, scaled_face_size );
+            auto* xs = map_x.ptr<float>( area.y + y, area.x );
+            auto* ys = map_y.ptr<float>( area.y + y, area.x );
+            for (int x = 0; x < scaled_face_size; ++x) {
+               const glm::vec2 st = (glm::vec2(x, y) + 0.5f) / static_cast<float>(scaled_face_size);
+               glm::vec2 position;
+               if (projection( glm::normalize( getCubeMapDirection( face, st ) ), position )) {
+                  xs[x] = (position.x + 0.5f) * scale - 0.5f;
+                  ys[x] = (position.y + 0.5f) * scale - 0.5f;
+               }
+               else xs[x] = ys[x] = -1.0f;
+            }
+         }
+      }
+   );
+   cv::convertMaps( map_x, map_y, maps[0], maps[1], CV_16SC2 );
+}
+
+void CubeFaceRemap::build(const Projection& projection, int face_size, VideoSource::PixelFormat pixel_format)
+{
+   FaceSize = face_size;
+   buildMaps( projection, face_size, 1.0f, LumaMaps );
+   if (pixel_format == VideoSource::PixelFormat::NV12) buildMaps( projection, face_size, 0.5f, ChromaMaps );
+   else for (auto& map : ChromaMaps) map.release();
+}
+
+void CubeFaceRemap::apply(const cv::Mat& source, cv::Mat& atlas, VideoSource::PixelFormat pixel_format) const
+{
+   // cv::remap splits the rows across threads and interpolates with SIMD when given fixed-point maps.
+   const cv::Size atlas_size = getAtlasSize( FaceSize );
+   if (pixel_format == VideoSource::PixelFormat::BGR) {
+      atlas.create( atlas_size, CV_8UC3 );
+      cv::remap( source, atlas, LumaMaps[0], LumaMaps[1], cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0) );
+      return;
+   }
+
+   // The directions that no lens covers are black in limited-range YUV.
+   const int source_height = source.rows * 2 / 3;
+   const cv::Mat source_luma = source.rowRange( 0, source_height );
+   const cv::Mat source_chroma(
+      source_height / 2, source.cols / 2, CV_8UC2, const_cast<uint8_t*>(source.ptr<uint8_t>( source_height ))
+   );
+   atlas.create( atlas_size.height * 3 / 2, atlas_size.width, CV_8UC1 );
+   cv::Mat luma = atlas.rowRange( 0, atlas_size.height );
+   cv::Mat chroma(atlas_size.height / 2, atlas_size.width / 2, CV_8UC2, atlas.ptr<uint8_t>( atlas_size.height ));
+   cv::remap( source_luma, luma, LumaMaps[0], LumaMaps[1], cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(16) );
+   cv::remap(
+      source_chroma, chroma, ChromaMaps[0], ChromaMaps[1], cv::INTER_LINEAR, cv::BORDER_CONSTANT,
+      cv::Scalar(128, 128)
+   );
+}
+
+void CubeFaceRemap::splitAtlas(
+   const cv::Mat& atlas,
+   VideoSource::PixelFormat pixel_format,
+   std::vector<cv::Mat>& faces
+)
+{
+   faces.resize( 6 );
+   if (pixel_format == VideoSource::PixelFormat::BGR) {
+      const int face_size = atlas.cols / 3;
+      for (int i = 0; i < 6; ++i) faces[i] = atlas( getFaceArea( i, face_size ) ).clone();
+      return;
+   }
+
+   const int atlas_height = atlas.rows * 2 / 3;
+   const int face_size = atlas.cols / 3;
+   const cv::Mat chroma(
+      atlas_height / 2, atlas.cols / 2, CV_8UC2, const_cast<uint8_t*>(atlas.ptr<uint8_t>( atlas_height ))
+   );
+   for (int i = 0; i < 6; ++i) {
+      faces[i].create( face_size * 3 / 2, face_size, CV_8UC1 );
+      atlas( getFaceArea( i, face_size ) ).copyTo( faces[i].rowRange( 0, face_size ) );
+      const cv::Mat face_chroma(face_size / 2, face_size / 2, CV_8UC2, faces[i].ptr<uint8_t>( face_size ));
+      chroma( getFaceArea( i, face_size / 2 ) ).copyTo( face_chroma );
+   }
+}
\ No newline at end of file
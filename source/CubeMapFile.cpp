@@ -0,0 +1,143 @@
+#include "CubeMapFile.h"
+#include "BlockCompressor.h"
+
+CubeMapFile::CubeMapFile() : Header{}
+{
+}
+
+uint64_t CubeMapFile::getContentHash(const std::vector<std::string>& image_paths)
+{
+   // Every byte of the images counts, because a cube map made of an edited face should not be taken for another.
+   ContentHasher hasher;
+   for (const auto& path : image_paths) {
+      MappedFile image;
+      const uint64_t size = image.open( path ) ? image.getSize() : 0;
+      hasher.add( &size, sizeof( size ) );
+      if (size > 0) hasher.add( image.getData(), image.getSize() );
+   }
+   return hasher.getHash();
+}
+
+std::string CubeMapFile::getCachePath(const std::string& directory, uint64_t content_hash)
+{
+   std::ostringstream name;
+   name << std::hex << std::setw( 16 ) << std::setfill( '0' ) << content_hash << Extension;
+   return (std::filesystem::path(directory) / name.str()).string();
+}
+
+int CubeMapFile::getLevelNum(int width, int height)
+{
+   int level_num = 1;
+   for (int size = std::max( width, height ); size > 1; size >>= 1) level_num++;
+   return level_num;
+}
+
+bool CubeMapFile::write(
+   const std::string& file_path,
+   uint64_t content_hash,
+   GLenum internal_format,
+   GLenum format,
+   GLenum type,
+   const std::vector<std::array<cv::Mat, 6>>& levels
+)
+{
+   if (levels.empty()) return false;
+
+   FileHeader header{};
+   std::memcpy( header.Magic, "CMCF", 4 );
+   header.Version = 2;
+   header.ContentHash = content_hash;
+   header.InternalFormat = internal_format;
+   header.Format = format;
+   header.Type = type;
+   header.Width = levels[0][0].cols;
+   header.Height = levels[0][0].rows;
+   header.LevelNum = static_cast<uint32_t>(levels.size());
+
+   // Every face starts on a page, so that it can be uploaded from the mapping without touching its neighbors.
+   std::vector<FaceEntry> faces;
+   uint64_t offset = sizeof( FileHeader ) + levels.size() * 6 * sizeof( FaceEntry );
+   for (const auto& level : levels) {
+      for (const auto& face : level) {
+         if (!face.isContinuous()) return false;
+         offset = (offset + PayloadAlignment - 1) / PayloadAlignment * PayloadAlignment;
+         faces.push_back( { offset, static_cast<uint64_t>(face.total() * face.elemSize()) } );
+         offset += faces.back().Size;
+      }
+   }
+
+   StagedFileWriter staged_writer;
+   if (!staged_writer.open( file_path )) return false;
+
+   std::ofstream& writer = staged_writer.getStream();
+   writer.write( reinterpret_cast<const char*>(&header), sizeof( FileHeader ) );
+   writer.write(
+      reinterpret_cast<const char*>(faces.data()),
+      static_cast<std::streamsize>(faces.size() * sizeof( FaceEntry ))
+   );
+   const std::vector<char> padding(PayloadAlignment, 0);
+   for (size_t i = 0; i < faces.size(); ++i) {
+      const auto position = static_cast<uint64_t>(writer.tellp());
+      writer.write( padding.data(), static_cast<std::streamsize>(faces[i].Offset - position) );
+      const cv::Mat& face = levels[i / 6][i % 6];
+      writer.write( reinterpret_cast<const char*>(face.data), static_cast<std::streamsize>(faces[i].Size) );
+   }
+   return staged_writer.commit();
+}
+
+bool CubeMapFile::open(const std::string& file_path, uint64_t content_hash)
+{
+   close();
+   if (!File.open( file_path ) || File.getSize() < sizeof( FileHeader )) {
+      close();
+      return false;
+   }
+
+   std::memcpy( &Header, File.getData(), sizeof( FileHeader ) );
+   const uint64_t table_end = sizeof( FileHeader ) + static_cast<uint64_t>(Header.LevelNum) * 6 * sizeof( FaceEntry );
+   bool valid =
+      std::memcmp( Header.Magic, "CMCF", 4 ) == 0 && Header.Version == 2 &&
+      (content_hash == 0 || Header.ContentHash == content_hash) && Header.Width > 0 && Header.Height > 0 &&
+      Header.Width == Header.Height && Header.LevelNum > 0 &&
+      static_cast<int>(Header.LevelNum) <= getLevelNum( Header.Width, Header.Height ) && table_end <= File.getSize();
+   if (valid) {
+      Faces.resize( Header.LevelNum * 6 );
+      std::memcpy( Faces.data(), File.getData() + sizeof( FileHeader ), Faces.size() * sizeof( FaceEntry ) );
+      // Every face is uploaded with the size of its level, so it should hold exactly that many bytes.
+      for (size_t i = 0; i < Faces.size(); ++i) {
+         const FaceEntry& face = Faces[i];
+         const uint64_t face_bytes = getExpectedFaceBytes( static_cast<int>(i / 6) );
+         valid = valid && face_bytes > 0 && face.Size == face_bytes && face.Offset >= table_end &&
+            face.Offset <= File.getSize() && face.Size <= File.getSize() - face.Offset;
+      }
+   }
+   if (!valid) {
+      close();
+      return false;
+   }
+   return true;
+}
+
+uint64_t CubeMapFile::getExpectedFaceBytes(int level) const
+{
+   const cv::Size size = getFaceSize( level );
+   const auto width = static_cast<uint64_t>(size.width);
+   const auto height = static_cast<uint64_t>(size.height);
+   if (Header.InternalFormat == GL_RGBA8) return Header.Format != 0 ? width * height * 4 : 0;
+   if (Header.Format != 0) return 0;
+
+   // The blocks of a level whose size is not a multiple of 4 cover its padding as well.
+   for (const auto format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 }) {
+      if (Header.InternalFormat == BlockCompressor::getInternalFormat( format )) {
+         return (width + 3) / 4 * ((height + 3) / 4) * static_cast<uint64_t>(BlockCompressor::getBlockBytes( format ));
+      }
+   }
+   return 0;
+}
+
+void CubeMapFile::close()
+{
+   File.close();
+   Faces.clear();
+   Header = FileHeader{};
+}
@@ -0,0 +1,191 @@
+#include "CubeMipGenerator.h"
+#include "CubeFaceRemap.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+int CubeMipGenerator::downsampleRowBGRA(const uint8_t* top, const uint8_t* bottom, uint8_t* half_row, int half_width)
+{
+   // The texels are widened to 16 bits, the two rows are added, and then the two texels of each pair are added by
+   // shifting the upper one onto the lower one.
+   int x = 0;
+#if defined(__AVX2__)
+   const __m256i zero = _mm256_setzero_si256();
+   const __m256i rounding = _mm256_set1_epi16( 2 );
+   for (; x + 8 <= half_width; x += 8) {
+      // Each lane halves its own four texels, so the halved texels come out as 0, 1, 4, 5, 2, 3, 6 and 7.
+      __m256i sums[2];
+      for (int i = 0; i < 2; ++i) {
+         const int offset = (x + i * 4) * 8;
+         const __m256i t = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(top + offset) );
+         const __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(bottom + offset) );
+         const __m256i low = _mm256_add_epi16( _mm256_unpacklo_epi8( t, zero ), _mm256_unpacklo_epi8( b, zero ) );
+         const __m256i high = _mm256_add_epi16( _mm256_unpackhi_epi8( t, zero ), _mm256_unpackhi_epi8( b, zero ) );
+         const __m256i sum = _mm256_unpacklo_epi64(
+            _mm256_add_epi16( low, _mm256_srli_si256( low, 8 ) ),
+            _mm256_add_epi16( high, _mm256_srli_si256( high, 8 ) )
+         );
+         sums[i] = _mm256_srli_epi16( _mm256_add_epi16( sum, rounding ), 2 );
+      }
+      const __m256i packed = _mm256_packus_epi16( sums[0], sums[1] );
+      _mm256_storeu_si256(
+         reinterpret_cast<__m256i*>(half_row + x * 4),
+         _mm256_permute4x64_epi64( packed, _MM_SHUFFLE( 3, 1, 2, 0 ) )
+      );
+   }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+   const __m128i zero128 = _mm_setzero_si128();
+   const __m128i rounding128 = _mm_set1_epi16( 2 );
+   for (; x + 4 <= half_width; x += 4) {
+      __m128i sums[2];
+      for (int i = 0; i < 2; ++i) {
+         const int offset = (x + i * 2) * 8;
+         const __m128i t = _mm_loadu_si128( reinterpret_cast<const __m128i*>(top + offset) );
+         const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>(bottom + offset) );
+         const __m128i low = _mm_add_epi16( _mm_unpacklo_epi8( t, zero128 ), _mm_unpacklo_epi8( b, zero128 ) );
+         const __m128i high = _mm_add_epi16( _mm_unpackhi_epi8( t, zero128 ), _mm_unpackhi_epi8( b, zero128 ) );
+         const __m128i sum = _mm_unpacklo_epi64(
+            _mm_add_epi16( low, _mm_srli_si128( low, 8 ) ),
+            _mm_add_epi16( high, _mm_srli_si128( high, 8 ) )
+         );
+         sums[i] = _mm_srli_epi16( _mm_add_epi16( sum, rounding128 ), 2 );
+      }
+      _mm_storeu_si128( reinterpret_cast<__m128i*>(half_row + x * 4), _mm_packus_epi16( sums[0], sums[1] ) );
+   }
+#endif
+   return x;
+}
+
+void CubeMipGenerator::downsampleRow(
+   const uint8_t* top,
+   const uint8_t* bottom,
+   uint8_t* half_row,
+   int width,
+   int half_width,
+   int channels,
+   int start_x
+)
+{
+   for (int x = start_x; x < half_width; ++x) {
+      const int left = std::min( x * 2, width - 1 ) * channels;
+      const int right = std::min( x * 2 + 1, width - 1 ) * channels;
+      for (int c = 0; c < channels; ++c) {
+         half_row[x * channels + c] =
+            static_cast<uint8_t>((top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) >> 2);
+      }
+   }
+}
+
+void CubeMipGenerator::downsample(const cv::Mat& image, cv::Mat& half)
+{
+   CV_Assert( image.depth() == CV_8U && !image.empty() );
+
+   // An odd row or column at the end is left out, and a single one is kept as it is.
+   half.create( std::max( image.rows >> 1, 1 ), std::max( image.cols >> 1, 1 ), image.type() );
+   const int channels = image.channels();
+   cv::parallel_for_(
+      cv::Range(0, half.rows),
+      [&](const cv::Range& range) {
+         for (int y = range.start; y < range.end; ++y) {
+            const uint8_t* top = image.ptr<uint8_t>( std::min( y * 2, image.rows - 1 ) );
+            const uint8_t* bottom = image.ptr<uint8_t>( std::min( y * 2 + 1, image.rows - 1 ) );
+            uint8_t* half_row = half.ptr<uint8_t>( y );
+            const int start_x =
+               channels == 4 && image.cols > 1 ? downsampleRowBGRA( top, bottom, half_row, half.cols ) : 0;
+            downsampleRow( top, bottom, half_row, image.cols, half.cols, channels, start_x );
+         }
+      }
+   );
+}
+
+void CubeMipGenerator::getFaceCoordinates(const glm::vec3& direction, int face, float& u, float& v)
+{
+   const float major = std::abs( direction[face / 2] );
+   switch (face) {
+      case 0: u = -direction.z; v = -direction.y; break;
+      case 1: u = direction.z; v = -direction.y; break;
+      case 2: u = direction.x; v = direction.z; break;
+      case 3: u = direction.x; v = -direction.z; break;
+      case 4: u = direction.x; v = -direction.y; break;
+      default: u = -direction.x; v = -direction.y; break;
+   }
+   u /= major;
+   v /= major;
+}
+
+void CubeMipGenerator::averageFaceEdges(std::array<cv::Mat, 6>& faces)
+{
+   const int size = faces[0].cols;
+   const int channels = faces[0].channels();
+   for (const auto& face : faces) {
+      if (face.cols != size || face.rows != size || face.type() != faces[0].type()) return;
+   }
+
+   // With a single texel per face, every face meets every other one.
+   if (size == 1) {
+      for (int c = 0; c < channels; ++c) {
+         int sum = 0;
+         for (const auto& face : faces) sum += face.data[c];
+         for (auto& face : faces) face.data[c] = static_cast<uint8_t>((sum + 3) / 6);
+      }
+      return;
+   }
+
+   // A texel on an edge is moved onto the edge, where the direction to it reaches two faces, or three at a corner,
+   // and the texels it reaches on them are averaged. A texel reaches the same ones from any of those faces, so each
+   // group of texels is averaged once however often it is visited.
+   std::vector<uint8_t*> texels;
+   std::vector<int> sums(channels);
+   for (int face = 0; face < 6; ++face) {
+      for (int y = 0; y < size; ++y) {
+         const int x_step = y == 0 || y == size - 1 ? 1 : size - 1;
+         for (int x = 0; x < size; x += x_step) {
+            float u = (2.0f * static_cast<float>(x) + 1.0f) / static_cast<float>(size) - 1.0f;
+            float v = (2.0f * static_cast<float>(y) + 1.0f) / static_cast<float>(size) - 1.0f;
+            if (x == 0) u = -1.0f;
+            else if (x == size - 1) u = 1.0f;
+            if (y == 0) v = -1.0f;
+            else if (y == size - 1) v = 1.0f;
+            const glm::vec3 direction =
+               CubeFaceRemap::getCubeMapDirection( face, glm::vec2((u + 1.0f) * 0.5f, (v + 1.0f) * 0.5f) );
+
+            texels.clear();
+            for (int axis = 0; axis < 3; ++axis) {
+               if (std::abs( direction[axis] ) != 1.0f) continue;
+               const int neighbor = axis * 2 + (direction[axis] > 0.0f ? 0 : 1);
+               float neighbor_u, neighbor_v;
+               getFaceCoordinates( direction, neighbor, neighbor_u, neighbor_v );
+               const int tx =
+                  std::clamp( static_cast<int>((neighbor_u + 1.0f) * 0.5f * static_cast<float>(size)), 0, size - 1 );
+               const int ty =
+                  std::clamp( static_cast<int>((neighbor_v + 1.0f) * 0.5f * static_cast<float>(size)), 0, size - 1 );
+               texels.emplace_back( faces[neighbor].ptr<uint8_t>( ty ) + tx * channels );
+            }
+            std::fill( sums.begin(), sums.end(), 0 );
+            for (const auto& texel : texels) {
+               for (int c = 0; c < channels; ++c) sums[c] += texel[c];
+            }
+            const auto texel_num = static_cast<int>(texels.size());
+            for (const auto& texel : texels) {
+               for (int c = 0; c < channels; ++c) {
+                  texel[c] = static_cast<uint8_t>((sums[c] + texel_num / 2) / texel_num);
+               }
+            }
+         }
+      }
+   }
+}
+
+void CubeMipGenerator::addMipLevels(std::vector<std::array<cv::Mat, 6>>& levels)
+{
+   while (levels.back()[0].cols > 1 || levels.back()[0].rows > 1) {
+      std::array<cv::Mat, 6> faces;
+      for (int face = 0; face < 6; ++face) downsample( levels.back()[face], faces[face] );
+      averageFaceEdges( faces );
+      levels.emplace_back( std::move( faces ) );
+   }
+}
@@ -0,0 +1,207 @@
+#include "FFmpegVideoSource.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+}
+
+FFmpegVideoSource::FFmpegVideoSource() :
+   Format( PixelFormat::BGR ), StreamIndex( -1 ), Draining( false ), HasPendingFrame( false ), FPS( 0.0 ), TimeBase( 0.0 ), StartTime( 0 ),
+   Timestamp( 0.0 ), FormatContext( nullptr ), CodecContext( nullptr ), Packet( nullptr ), DecodedFrame( nullptr ),
+   Converter( nullptr )
+{
+}
+
+FFmpegVideoSource::~FFmpegVideoSource()
+{
+   close();
+}
+
+bool FFmpegVideoSource::open(const std::string& video_path, PixelFormat pixel_format)
+{
+   close();
+   Format = pixel_format;
+   VideoPath = video_path;
+   if (avformat_open_input( &FormatContext, video_path.c_str(), nullptr, nullptr ) < 0) return false;
+   if (avformat_find_stream_info( FormatContext, nullptr ) < 0) {
+      close();
+      return false;
+   }
+
+   StreamIndex = av_find_best_stream( FormatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0 );
+   if (StreamIndex < 0) {
+      close();
+      return false;
+   }
+   const AVStream* stream = FormatContext->streams[StreamIndex];
+   const AVCodec* codec = avcodec_find_decoder( stream->codecpar->codec_id );
+   CodecContext = codec != nullptr ? avcodec_alloc_context3( codec ) : nullptr;
+   if (CodecContext == nullptr || avcodec_parameters_to_context( CodecContext, stream->codecpar ) < 0) {
+      close();
+      return false;
+   }
+
+   // Frame threads decode several frames at once at the cost of a few frames of latency, which the ring of
+   // the stream hides. A thread count of 0 lets the decoder pick one per core.
+   CodecContext->thread_count = 0;
+   CodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+   if (avcodec_open2( CodecContext, codec, nullptr ) < 0) {
+      close();
+      return false;
+   }
+
+   const AVRational frame_rate = stream->avg_frame_rate.num > 0 ? stream->avg_frame_rate : stream->r_frame_rate;
+   FPS = frame_rate.num > 0 && frame_rate.den > 0 ? av_q2d( frame_rate ) : 0.0;
+   TimeBase = 1000.0 * av_q2d( stream->time_base );
+   StartTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+   FrameSize = cv::Size(CodecContext->width, CodecContext->height);
+   Timestamp = 0.0;
+   Draining = false;
+   HasPendingFrame = false;
+   Packet = av_packet_alloc();
+   DecodedFrame = av_frame_alloc();
+   return true;
+}
+
+void FFmpegVideoSource::close()
+{
+   if (Converter != nullptr) sws_freeContext( Converter );
+   if (DecodedFrame != nullptr) av_frame_free( &DecodedFrame );
+   if (Packet != nullptr) av_packet_free( &Packet );
+   if (CodecContext != nullptr) avcodec_free_context( &CodecContext );
+   if (FormatContext != nullptr) avformat_close_input( &FormatContext );
+   Converter = nullptr;
+   StreamIndex = -1;
+   HasPendingFrame = false;
+}
+
+bool FFmpegVideoSource::decodeFrame()
+{
+   if (CodecContext == nullptr) return false;
+   if (HasPendingFrame) {
+      HasPendingFrame = false;
+      return true;
+   }
+
+   while (true) {
+      auto start = std::chrono::steady_clock::now();
+      const int result = avcodec_receive_frame( CodecContext, DecodedFrame );
+      addStageTime( Stage::Decode, start );
+      if (result == 0) break;
+      if (result != AVERROR(EAGAIN) || Draining) return false;
+
+      start = std::chrono::steady_clock::now();
+      const bool demuxed = av_read_frame( FormatContext, Packet ) >= 0;
+      addStageTime( Stage::Demux, start );
+      start = std::chrono::steady_clock::now();
+      if (!demuxed) {
+         // The frames still held by the frame threads come out after the flush packet.
+         avcodec_send_packet( CodecContext, nullptr );
+         Draining = true;
+      }
+      else if (Packet->stream_index == StreamIndex) avcodec_send_packet( CodecContext, Packet );
+      addStageTime( Stage::Decode, start );
+      if (demuxed) av_packet_unref( Packet );
+   }
+   countFrame();
+
+   const int64_t pts = DecodedFrame->best_effort_timestamp;
+   if (pts != AV_NOPTS_VALUE) Timestamp = static_cast<double>(pts - StartTime) * TimeBase;
+   else if (FPS > 0.0) Timestamp += 1000.0 / FPS;
+   return true;
+}
+
+bool FFmpegVideoSource::convertFrame(cv::Mat& image)
+{
+   const int width = DecodedFrame->width;
+   const int height = DecodedFrame->height;
+   const bool nv12 = Format == PixelFormat::NV12;
+   if (nv12) image.create( height * 3 / 2, width, CV_8UC1 );
+   else image.create( height, width, CV_8UC3 );
+
+   std::array<uint8_t*, 4> planes{ image.data, nv12 ? image.ptr<uint8_t>( height ) : nullptr, nullptr, nullptr };
+   std::array<int, 4> strides{ static_cast<int>(image.step), nv12 ? static_cast<int>(image.step) : 0, 0, 0 };
+   const auto source_format = static_cast<AVPixelFormat>(DecodedFrame->format);
+   if (nv12 && source_format == AV_PIX_FMT_NV12) {
+      av_image_copy_plane(
+         planes[0], strides[0], DecodedFrame->data[0], DecodedFrame->linesize[0], width, height
+      );
+      av_image_copy_plane(
+         planes[1], strides[1], DecodedFrame->data[1], DecodedFrame->linesize[1], width, height / 2
+      );
+      return true;
+   }
+
+   // Only the chroma is interleaved from YUV 4:2:0 to NV12, so no filtering is needed.
+   Converter = sws_getCachedContext(
+      Converter,
+      width, height, source_format,
+      width, height, nv12 ? AV_PIX_FMT_NV12 : AV_PIX_FMT_BGR24,
+      nv12 ? SWS_POINT : SWS_BILINEAR, nullptr, nullptr, nullptr
+   );
+   if (Converter == nullptr) return false;
+
+   sws_scale( Converter, DecodedFrame->data, DecodedFrame->linesize, 0, height, planes.data(), strides.data() );
+   return true;
+}
+
+bool FFmpegVideoSource::read(cv::Mat& image)
+{
+   if (!decodeFrame()) return false;
+
+   const auto start = std::chrono::steady_clock::now();
+   const bool converted = convertFrame( image );
+   addStageTime( Stage::Convert, start );
+   return converted;
+}
+
+bool FFmpegVideoSource::skip()
+{
+   return decodeFrame();
+}
+
+bool FFmpegVideoSource::seek(int64_t frame_index)
+{
+   if (CodecContext == nullptr || FPS <= 0.0) return false;
+
+   // The demuxer lands on the keyframe before the frame, and the frames up to it are decoded without conversion.
+   const double target = static_cast<double>(frame_index) * 1000.0 / FPS;
+   const auto timestamp = StartTime + static_cast<int64_t>(target / TimeBase);
+   if (av_seek_frame( FormatContext, StreamIndex, timestamp, AVSEEK_FLAG_BACKWARD ) < 0) return false;
+
+   // The frame reached is the target, so it is kept for the next read rather than dropped.
+   avcodec_flush_buffers( CodecContext );
+   Draining = false;
+   HasPendingFrame = false;
+   const double half_frame = 500.0 / FPS;
+   do {
+      if (!decodeFrame()) return false;
+   } while (Timestamp + half_frame < target);
+   HasPendingFrame = true;
+   return true;
+}
+
+bool FFmpegVideoSource::getKeyframes(std::vector<int64_t>& keyframes)
+{
+   // The packets are only demuxed, on a context of their own so that the decoding position is kept.
+   keyframes.clear();
+   AVFormatContext* context = nullptr;
+   if (FPS <= 0.0 || avformat_open_input( &context, VideoPath.c_str(), nullptr, nullptr ) < 0) return false;
+
+   if (avformat_find_stream_info( context, nullptr ) >= 0) {
+      AVPacket* packet = av_packet_alloc();
+      while (av_read_frame( context, packet ) >= 0) {
+         const bool is_keyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+         if (packet->stream_index == StreamIndex && is_keyframe && packet->pts != AV_NOPTS_VALUE) {
+            const double time = static_cast<double>(packet->pts - StartTime) * TimeBase;
+            keyframes.emplace_back( std::llround( time * FPS / 1000.0 ) );
+         }
+         av_packet_unref( packet );
+      }
+      av_packet_free( &packet );
+   }
+   avformat_close_input( &context );
+   return !keyframes.empty();
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "FrameDelta.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+void FrameDelta::markDirtyBlocksInRow(
+   uint8_t* block_row,
+   const uint8_t* current,
+   const uint8_t* previous,
+   int row_bytes,
+   int block_bytes
+)
+{
+   // A block is BlockSize pixels wide, so block_bytes is a multiple of 16 for 1, 2, 3 and 4 byte pixels,
+   // and a 16-byte chunk never straddles two blocks.
+   int offset = 0;
+#if defined(__AVX2__)
+   for (; offset + 32 <= row_bytes; offset += 32) {
+      const __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(current + offset) );
+      const __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(previous + offset) );
+      const auto equal = static_cast<uint32_t>(_mm256_movemask_epi8( _mm256_cmpeq_epi8( a, b ) ));
+      if (equal == 0xFFFFFFFFu) continue;
+      if ((equal & 0xFFFFu) != 0xFFFFu) block_row[offset / block_bytes] = 1;
+      if ((equal >> 16) != 0xFFFFu) block_row[(offset + 16) / block_bytes] = 1;
+   }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+   for (; offset + 16 <= row_bytes; offset += 16) {
+      const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>(current + offset) );
+      const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>(previous + offset) );
+      if (_mm_movemask_epi8( _mm_cmpeq_epi8( a, b ) ) != 0xFFFF) block_row[offset / block_bytes] = 1;
+   }
+#endif
+   for (; offset < row_bytes; ++offset) {
+      if (current[offset] != previous[offset]) block_row[offset / block_bytes] = 1;
+   }
+}
+
+void FrameDelta::markDirtyBlocksInPlane(
+   std::vector<uint8_t>& dirty_blocks,
+   const cv::Mat& current,
+   const cv::Mat& previous,
+   int block_size
+)
+{
+   const int grid_width = (current.cols + block_size - 1) / block_size;
+   const auto row_bytes = static_cast<int>(current.cols * current.elemSize());
+   const auto block_bytes = static_cast<int>(block_size * current.elemSize());
+   for (int y = 0; y < current.rows; ++y) {
+      markDirtyBlocksInRow(
+         dirty_blocks.data() + (y / block_size) * grid_width,
+         current.ptr<uint8_t>( y ),
+         previous.ptr<uint8_t>( y ),
+         row_bytes,
+         block_bytes
+      );
+   }
+}
+
+void FrameDelta::findDirtyBlocks(std::vector<uint8_t>& dirty_blocks, const cv::Mat& current, const cv::Mat& previous)
+{
+   if (previous.size() != current.size() || previous.type() != current.type()) {
+      markAllBlocksDirty( dirty_blocks, current.size() );
+      return;
+   }
+
+   dirty_blocks.assign( getBlockGridSize( current.size() ).area(), 0 );
+   markDirtyBlocksInPlane( dirty_blocks, current, previous, BlockSize );
+}
+
+void FrameDelta::findDirtyBlocksNV12(
+   std::vector<uint8_t>& dirty_blocks,
+   const cv::Mat& current,
+   const cv::Mat& previous,
+   const cv::Size& picture_size
+)
+{
+   if (previous.size() != current.size() || previous.type() != current.type()) {
+      markAllBlocksDirty( dirty_blocks, picture_size );
+      return;
+   }
+
+   // A block of the interleaved UV plane is half the size of a luma block, so both planes share the block grid.
+   const cv::Rect luma(0, 0, picture_size.width, picture_size.height);
+   const cv::Size chroma_size(picture_size.width / 2, picture_size.height / 2);
+   const cv::Mat current_chroma(
+      chroma_size, CV_8UC2, const_cast<uint8_t*>(current.ptr<uint8_t>( picture_size.height )), current.step
+   );
+   const cv::Mat previous_chroma(
+      chroma_size, CV_8UC2, const_cast<uint8_t*>(previous.ptr<uint8_t>( picture_size.height )), previous.step
+   );
+   dirty_blocks.assign( getBlockGridSize( picture_size ).area(), 0 );
+   markDirtyBlocksInPlane( dirty_blocks, current( luma ), previous( luma ), BlockSize );
+   markDirtyBlocksInPlane( dirty_blocks, current_chroma, previous_chroma, BlockSize / 2 );
+}
+
+void FrameDelta::markAllBlocksDirty(std::vector<uint8_t>& dirty_blocks, const cv::Size& frame_size)
+{
+   dirty_blocks.assign( getBlockGridSize( frame_size ).area(), 1 );
+}
+
+void FrameDelta::mergeDirtyBlocks(std::vector<uint8_t>& dirty_blocks, const std::vector<uint8_t>& other)
+{
+   if (dirty_blocks.size() != other.size()) {
+      // The grids differ only when the frame size changed, and then the whole frame has to be uploaded anyway.
+      dirty_blocks.assign( std::max( dirty_blocks.size(), other.size() ), 1 );
+      return;
+   }
+   for (size_t i = 0; i < dirty_blocks.size(); ++i) dirty_blocks[i] |= other[i];
+}
+
+void FrameDelta::getDirtyRects(
+   std::vector<cv::Rect>& dirty_rects,
+   const std::vector<uint8_t>& dirty_blocks,
+   const cv::Size& frame_size
+)
+{
+   // Runs of dirty blocks in a block row become rectangles, and a rectangle grows downward while the next block row
+   // has a run with the same span.
+   dirty_rects.clear();
+   const cv::Size grid = getBlockGridSize( frame_size );
+   if (dirty_blocks.size() != static_cast<size_t>(grid.area())) {
+      dirty_rects.emplace_back( 0, 0, frame_size.width, frame_size.height );
+      return;
+   }
+
+   std::vector<int> open_rects, next_open_rects;
+   for (int by = 0; by < grid.height; ++by) {
+      next_open_rects.clear();
+      const uint8_t* block_row = dirty_blocks.data() + by * grid.width;
+      for (int bx = 0; bx < grid.width;) {
+         if (block_row[bx] == 0) {
+            bx++;
+            continue;
+         }
+         const int start = bx;
+         while (bx < grid.width && block_row[bx] != 0) bx++;
+
+         const cv::Rect run(start * BlockSize, by * BlockSize, (bx - start) * BlockSize, BlockSize);
+         const auto it = std::find_if(
+            open_rects.begin(), open_rects.end(),
+            [&](int i) { return dirty_rects[i].x == run.x && dirty_rects[i].width == run.width; }
+         );
+         if (it != open_rects.end()) {
+            dirty_rects[*it].height += BlockSize;
+            next_open_rects.emplace_back( *it );
+         }
+         else {
+            next_open_rects.emplace_back( static_cast<int>(dirty_rects.size()) );
+            dirty_rects.emplace_back( run );
+         }
+      }
+      std::swap( open_rects, next_open_rects );
+   }
+
+   const cv::Rect frame_rect(0, 0, frame_size.width, frame_size.height);
+   for (auto& rect : dirty_rects) rect &= frame_rect;
+}
@@ -0,0 +1,177 @@
+#include "FrameRecorder.h"
+
+FrameRecorderGL::FrameRecorderGL() :
+   Recording( false ), WaitForEncoder( false ), FrameDuration( 0.0 ), NextCaptureTime( 0.0 ), Buffer( 0 ),
+   SlotSize( 0 ), MappedData( nullptr ), Fences{}, NextSlot( 0 ), PendingSlotNum( 0 ), ReservedSlotNum( 0 ),
+   StopEncoding( false )
+{
+}
+
+FrameRecorderGL::~FrameRecorderGL()
+{
+   stop();
+}
+
+double FrameRecorderGL::getNow()
+{
+   return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool FrameRecorderGL::start(const std::string& video_path, int width, int height, double fps, bool wait_for_encoder)
+{
+   stop();
+   if (width <= 0 || height <= 0 || fps <= 0.0) return false;
+
+   if (!Writer.open( video_path, cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ), fps, cv::Size(width, height) )) {
+      std::cerr << "Could not open " << video_path.c_str() << " for recording\n";
+      return false;
+   }
+
+   VideoPath = video_path;
+   WaitForEncoder = wait_for_encoder;
+   FrameSize = cv::Size(width, height);
+   FrameDuration = 1000.0 / fps;
+   NextCaptureTime = getNow();
+   SlotSize = static_cast<GLsizeiptr>(width) * height * 3;
+   const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   glCreateBuffers( 1, &Buffer );
+   glNamedBufferStorage( Buffer, SlotSize * ReadbackSlotNum, nullptr, flags );
+   MappedData = static_cast<uint8_t*>(glMapNamedBufferRange( Buffer, 0, SlotSize * ReadbackSlotNum, flags ));
+   NextSlot = 0;
+   PendingSlotNum = 0;
+   ReservedSlotNum = 0;
+
+   QueuedSlots.clear();
+   RecordStatistics = Statistics();
+   StopEncoding = false;
+   Encoder = std::thread(&FrameRecorderGL::encode, this);
+   Recording = true;
+   return true;
+}
+
+void FrameRecorderGL::stop()
+{
+   if (!Recording) return;
+
+   // The frames already read back are still encoded, so the recording ends with the last captured frame.
+   while (PendingSlotNum > 0) collectSlot( getOldestPendingSlot(), true );
+   {
+      std::lock_guard<std::mutex> lock(Lock);
+      StopEncoding = true;
+   }
+   FrameQueued.notify_one();
+   Encoder.join();
+   Writer.release();
+
+   glUnmapNamedBuffer( Buffer );
+   glDeleteBuffers( 1, &Buffer );
+   Buffer = 0;
+   MappedData = nullptr;
+   Recording = false;
+
+   const Statistics statistics = getStatistics();
+   std::cout << "Recorded " << statistics.EncodedFrameNum << " frames to " << VideoPath.c_str()
+      << " (dropped frames: " << statistics.DroppedFrameNum << ")\n";
+}
+
+FrameRecorderGL::Statistics FrameRecorderGL::getStatistics() const
+{
+   std::lock_guard<std::mutex> lock(Lock);
+   return RecordStatistics;
+}
+
+void FrameRecorderGL::capture(int width, int height, GLuint framebuffer)
+{
+   if (!Recording) return;
+
+   // The oldest readbacks are handed to the encoder as soon as the GPU has finished them.
+   while (PendingSlotNum > 0) {
+      if (!collectSlot( getOldestPendingSlot(), false )) break;
+   }
+
+   if (!WaitForEncoder) {
+      const double now = getNow();
+      if (now < NextCaptureTime) return;
+      NextCaptureTime = std::max( NextCaptureTime + FrameDuration, now - FrameDuration );
+   }
+   else {
+      // The slots are freed in the order they were read into, so the next one is free once any of them is.
+      std::unique_lock<std::mutex> lock(Lock);
+      if (ReservedSlotNum == ReadbackSlotNum) {
+         lock.unlock();
+         while (PendingSlotNum > 0) collectSlot( getOldestPendingSlot(), true );
+         lock.lock();
+         SlotReleased.wait( lock, [this]() { return ReservedSlotNum < ReadbackSlotNum; } );
+      }
+   }
+
+   {
+      // The window was resized, or the GPU or the encoder has not finished with the last frames.
+      std::lock_guard<std::mutex> lock(Lock);
+      if (ReservedSlotNum == ReadbackSlotNum || width != FrameSize.width || height != FrameSize.height) {
+         RecordStatistics.DroppedFrameNum++;
+         return;
+      }
+      ReservedSlotNum++;
+   }
+
+   glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+   glNamedFramebufferReadBuffer( framebuffer, framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0 );
+   glBindFramebuffer( GL_READ_FRAMEBUFFER, framebuffer );
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, Buffer );
+   glReadPixels(
+      0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE,
+      reinterpret_cast<void*>(static_cast<GLintptr>(NextSlot) * SlotSize)
+   );
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+   glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+   Fences[NextSlot] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   NextSlot = (NextSlot + 1) % ReadbackSlotNum;
+   PendingSlotNum++;
+
+   std::lock_guard<std::mutex> lock(Lock);
+   RecordStatistics.CapturedFrameNum++;
+}
+
+bool FrameRecorderGL::collectSlot(int slot, bool wait)
+{
+   GLenum result = glClientWaitSync( Fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+   while (wait && result == GL_TIMEOUT_EXPIRED) {
+      result = glClientWaitSync( Fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+   }
+   if (result == GL_TIMEOUT_EXPIRED) return false;
+
+   glDeleteSync( Fences[slot] );
+   Fences[slot] = nullptr;
+   PendingSlotNum--;
+   {
+      std::lock_guard<std::mutex> lock(Lock);
+      QueuedSlots.emplace_back( slot );
+   }
+   FrameQueued.notify_one();
+   return true;
+}
+
+void FrameRecorderGL::encode()
+{
+   cv::Mat frame(FrameSize, CV_8UC3);
+   std::unique_lock<std::mutex> lock(Lock);
+   while (true) {
+      FrameQueued.wait( lock, [this]() { return StopEncoding || !QueuedSlots.empty(); } );
+      if (QueuedSlots.empty()) return;
+
+      // The rows of the back buffer start from the bottom, and the slot is read into again once they are flipped.
+      const int slot = QueuedSlots.front();
+      QueuedSlots.pop_front();
+      lock.unlock();
+      const cv::Mat pixels(FrameSize, CV_8UC3, MappedData + static_cast<GLintptr>(slot) * SlotSize);
+      cv::flip( pixels, frame, 0 );
+      lock.lock();
+      ReservedSlotNum--;
+      SlotReleased.notify_one();
+      lock.unlock();
+      Writer.write( frame );
+      lock.lock();
+      RecordStatistics.EncodedFrameNum++;
+   }
+}
@@ -0,0 +1,221 @@
+#include "FrameStore.h"
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+FrameStore::FrameStore() : Header{}, WrittenBytes( 0 )
+{
+}
+
+FrameStore::~FrameStore()
+{
+   abortWriting();
+}
+
+uint32_t FrameStore::getCompression()
+{
+#ifdef USE_LZ4
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+FrameStore::SourceStamp FrameStore::getSourceStamp(const std::string& source_path)
+{
+   // The hash covers the size and the first and the last MiB of the source, which is enough to tell re-encoded
+   // or replaced videos apart without reading all of them on every start.
+   SourceStamp stamp;
+   std::error_code error;
+   const auto size = std::filesystem::file_size( source_path, error );
+   if (error) return stamp;
+   const auto modified_time = std::filesystem::last_write_time( source_path, error );
+   if (error) return stamp;
+
+   stamp.Size = static_cast<int64_t>(size);
+   stamp.ModifiedTime = static_cast<int64_t>(modified_time.time_since_epoch().count());
+   ContentHasher hasher;
+   hasher.add( &stamp.Size, sizeof( stamp.Size ) );
+
+   constexpr size_t sample_size = 1 << 20;
+   std::vector<char> sample(sample_size);
+   std::ifstream file(source_path, std::ios::binary);
+   file.read( sample.data(), static_cast<std::streamsize>(sample_size) );
+   hasher.add( sample.data(), static_cast<size_t>(file.gcount()) );
+   if (size > sample_size) {
+      file.clear();
+      file.seekg( static_cast<std::streamoff>(size - sample_size) );
+      file.read( sample.data(), static_cast<std::streamsize>(sample_size) );
+      hasher.add( sample.data(), static_cast<size_t>(file.gcount()) );
+   }
+   stamp.Hash = hasher.getHash();
+   return stamp;
+}
+
+std::string FrameStore::getStorePath(const std::string& directory, const std::string& source_path, int pixel_format)
+{
+   std::error_code error;
+   const std::filesystem::path absolute_path = std::filesystem::absolute( source_path, error );
+   const std::string key = (error ? source_path : absolute_path.string()) + "#" + std::to_string( pixel_format );
+   std::ostringstream name;
+   name << std::hex << std::setw( 16 ) << std::setfill( '0' ) << std::hash<std::string>{}( key ) << Extension;
+   return (std::filesystem::path(directory) / name.str()).string();
+}
+
+int64_t FrameStore::enforceSizeLimit(
+   const std::string& directory,
+   int64_t size_limit,
+   const std::string& kept_store_path
+)
+{
+   // The least recently used stores go first, and reading a store marks it as used.
+   std::error_code error;
+   std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> stores;
+   int64_t total_size = 0;
+   for (const auto& entry : std::filesystem::directory_iterator( directory, error )) {
+      if (!entry.is_regular_file( error )) continue;
+      const std::filesystem::path& path = entry.path();
+      const bool is_writing =
+         path.extension() == StagedFileWriter::Extension && path.stem().extension() == Extension;
+      if (path.extension() != Extension && !is_writing) continue;
+      total_size += static_cast<int64_t>(entry.file_size( error ));
+      if (!is_writing) stores.emplace_back( entry.last_write_time( error ), path );
+   }
+   std::sort( stores.begin(), stores.end() );
+   for (const auto& store : stores) {
+      if (total_size <= size_limit) break;
+      if (store.second == std::filesystem::path(kept_store_path)) continue;
+      const auto size = static_cast<int64_t>(std::filesystem::file_size( store.second, error ));
+      if (std::filesystem::remove( store.second, error )) total_size -= size;
+   }
+   return total_size;
+}
+
+bool FrameStore::openForReading(const std::string& store_path, const SourceStamp& stamp)
+{
+   close();
+   if (stamp.Size < 0 || !Store.open( store_path )) return false;
+
+   const uint8_t* data = Store.getData();
+   const size_t size = Store.getSize();
+   if (size < sizeof( StoreHeader )) {
+      close();
+      return false;
+   }
+   std::memcpy( &Header, data, sizeof( StoreHeader ) );
+   const bool valid =
+      std::memcmp( Header.Magic, "CMFS", 4 ) == 0 && Header.Version == 1 && Header.Compression == getCompression() &&
+      Header.SourceHash == stamp.Hash && Header.SourceSize == stamp.Size &&
+      Header.SourceModifiedTime == stamp.ModifiedTime && Header.IndexOffset != 0 &&
+      Header.IndexOffset + Header.FrameNum * sizeof( IndexEntry ) <= size;
+   if (!valid) {
+      close();
+      return false;
+   }
+
+   Index.resize( Header.FrameNum );
+   std::memcpy( Index.data(), data + Header.IndexOffset, Header.FrameNum * sizeof( IndexEntry ) );
+   std::error_code error;
+   std::filesystem::last_write_time( store_path, std::filesystem::file_time_type::clock::now(), error );
+   return true;
+}
+
+bool FrameStore::readFrame(cv::Mat& image, int64_t index) const
+{
+   if (index < 0 || index >= getFrameNum()) return false;
+
+   const IndexEntry& entry = Index[index];
+   if (entry.Offset + entry.Size > Store.getSize()) return false;
+
+   // The frame is decompressed straight into the image of the caller.
+   image.create( Header.Rows, Header.Cols, Header.Type );
+   const auto frame_size = static_cast<int>(image.total() * image.elemSize());
+   const auto* frame = reinterpret_cast<const char*>(Store.getData() + entry.Offset);
+#ifdef USE_LZ4
+   return LZ4_decompress_safe( frame, reinterpret_cast<char*>(image.data), static_cast<int>(entry.Size), frame_size )
+      == frame_size;
+#else
+   if (static_cast<int>(entry.Size) != frame_size) return false;
+   std::memcpy( image.data, frame, entry.Size );
+   return true;
+#endif
+}
+
+bool FrameStore::beginWriting(const std::string& store_path, const SourceStamp& stamp, double fps)
+{
+   close();
+   if (stamp.Size < 0) return false;
+
+   if (!Writer.open( store_path )) return false;
+
+   Header = StoreHeader{};
+   std::memcpy( Header.Magic, "CMFS", 4 );
+   Header.Version = 1;
+   Header.Compression = getCompression();
+   Header.Type = -1;
+   Header.FPS = fps;
+   Header.SourceHash = stamp.Hash;
+   Header.SourceSize = stamp.Size;
+   Header.SourceModifiedTime = stamp.ModifiedTime;
+   Writer.getStream().write( reinterpret_cast<const char*>(&Header), sizeof( StoreHeader ) );
+   WrittenBytes = sizeof( StoreHeader );
+   Index.clear();
+   return Writer.getStream().good();
+}
+
+bool FrameStore::writeFrame(const cv::Mat& image, double timestamp)
+{
+   if (!Writer.isOpened() || !image.isContinuous()) return false;
+
+   if (Header.Type < 0) {
+      Header.Type = image.type();
+      Header.Rows = image.rows;
+      Header.Cols = image.cols;
+   }
+   else if (image.type() != Header.Type || image.rows != Header.Rows || image.cols != Header.Cols) return false;
+
+   const auto frame_size = static_cast<int>(image.total() * image.elemSize());
+   const char* frame = reinterpret_cast<const char*>(image.data);
+   int stored_size = frame_size;
+#ifdef USE_LZ4
+   CompressedFrame.resize( LZ4_compressBound( frame_size ) );
+   stored_size = LZ4_compress_default(
+      frame, CompressedFrame.data(), frame_size, static_cast<int>(CompressedFrame.size())
+   );
+   if (stored_size <= 0) return false;
+   frame = CompressedFrame.data();
+#endif
+   Index.push_back( { WrittenBytes, static_cast<uint64_t>(stored_size), timestamp } );
+   Writer.getStream().write( frame, stored_size );
+   WrittenBytes += static_cast<uint64_t>(stored_size);
+   return Writer.getStream().good();
+}
+
+bool FrameStore::finishWriting()
+{
+   if (!Writer.isOpened()) return false;
+
+   Header.FrameNum = Index.size();
+   Header.IndexOffset = WrittenBytes;
+   std::ofstream& writer = Writer.getStream();
+   writer.write(
+      reinterpret_cast<const char*>(Index.data()),
+      static_cast<std::streamsize>(Index.size() * sizeof( IndexEntry ))
+   );
+   writer.seekp( 0 );
+   writer.write( reinterpret_cast<const char*>(&Header), sizeof( StoreHeader ) );
+   return Writer.commit( !Index.empty() );
+}
+
+void FrameStore::abortWriting()
+{
+   Writer.abort();
+}
+
+void FrameStore::close()
+{
+   abortWriting();
+   Store.close();
+   Index.clear();
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "KeyframeIndex.h"
+
+bool KeyframeIndex::load(const std::string& video_path)
+{
+   // A sidecar older than the video belongs to a previous encoding of it.
+   Keyframes.clear();
+   const std::string sidecar_path = getSidecarPath( video_path );
+   std::error_code error;
+   const auto sidecar_time = std::filesystem::last_write_time( sidecar_path, error );
+   if (error) return false;
+   const auto video_time = std::filesystem::last_write_time( video_path, error );
+   if (error || sidecar_time < video_time) return false;
+
+   std::ifstream file(sidecar_path);
+   std::vector<int64_t> keyframes;
+   int64_t keyframe;
+   while (file >> keyframe) keyframes.emplace_back( keyframe );
+   set( std::move( keyframes ) );
+   return !Keyframes.empty();
+}
+
+bool KeyframeIndex::save(const std::string& video_path) const
+{
+   std::ofstream file(getSidecarPath( video_path ));
+   if (!file.is_open()) return false;
+
+   for (const auto& keyframe : Keyframes) file << keyframe << "\n";
+   return file.good();
+}
+
+void KeyframeIndex::set(std::vector<int64_t> keyframes)
+{
+   Keyframes = std::move( keyframes );
+   std::sort( Keyframes.begin(), Keyframes.end() );
+   Keyframes.erase( std::unique( Keyframes.begin(), Keyframes.end() ), Keyframes.end() );
+}
+
+int64_t KeyframeIndex::findKeyframe(int64_t frame_index) const
+{
+   const auto it = std::upper_bound( Keyframes.begin(), Keyframes.end(), frame_index );
+   return it == Keyframes.begin() ? frame_index : *(it - 1);
+}
\ No newline at end of file
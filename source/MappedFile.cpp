@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : Data( nullptr ), Size( 0 ), File( INVALID_HANDLE_VALUE ), Mapping( nullptr )
+{
+}
+
+bool MappedFile::open(const std::string& file_path)
+{
+   close();
+   File = CreateFileA(
+      file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+   );
+   LARGE_INTEGER file_size;
+   if (File == INVALID_HANDLE_VALUE || !GetFileSizeEx( File, &file_size ) || file_size.QuadPart == 0) {
+      close();
+      return false;
+   }
+
+   Mapping = CreateFileMappingA( File, nullptr, PAGE_READONLY, 0, 0, nullptr );
+   if (Mapping == nullptr) {
+      close();
+      return false;
+   }
+   Data = static_cast<const uint8_t*>(MapViewOfFile( Mapping, FILE_MAP_READ, 0, 0, 0 ));
+   if (Data == nullptr) {
+      close();
+      return false;
+   }
+   Size = static_cast<size_t>(file_size.QuadPart);
+   return true;
+}
+
+void MappedFile::close()
+{
+   if (Data != nullptr) UnmapViewOfFile( Data );
+   if (Mapping != nullptr) CloseHandle( Mapping );
+   if (File != INVALID_HANDLE_VALUE) CloseHandle( File );
+   Data = nullptr;
+   Size = 0;
+   Mapping = nullptr;
+   File = INVALID_HANDLE_VALUE;
+}
+#else
+MappedFile::MappedFile() : Data( nullptr ), Size( 0 ), File( -1 )
+{
+}
+
+bool MappedFile::open(const std::string& file_path)
+{
+   close();
+   File = ::open( file_path.c_str(), O_RDONLY );
+   struct stat file_status{};
+   if (File < 0 || fstat( File, &file_status ) != 0 || file_status.st_size == 0) {
+      close();
+      return false;
+   }
+
+   void* data = mmap( nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_SHARED, File, 0 );
+   if (data == MAP_FAILED) {
+      close();
+      return false;
+   }
+   Data = static_cast<const uint8_t*>(data);
+   Size = static_cast<size_t>(file_status.st_size);
+   return true;
+}
+
+void MappedFile::close()
+{
+   if (Data != nullptr) munmap( const_cast<uint8_t*>(Data), Size );
+   if (File >= 0) ::close( File );
+   Data = nullptr;
+   Size = 0;
+   File = -1;
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+   close();
+}
+
+StagedFileWriter::~StagedFileWriter()
+{
+   abort();
+}
+
+bool StagedFileWriter::open(const std::string& file_path)
+{
+   abort();
+   std::error_code error;
+   std::filesystem::create_directories( std::filesystem::path(file_path).parent_path(), error );
+   Writer.open( file_path + Extension, std::ios::binary | std::ios::trunc );
+   if (!Writer.is_open()) return false;
+
+   FilePath = file_path;
+   return true;
+}
+
+bool StagedFileWriter::commit(bool complete)
+{
+   if (!Writer.is_open()) return false;
+
+   const bool written = complete && Writer.good();
+   Writer.close();
+   std::error_code error;
+   const std::string writing_path = FilePath + Extension;
+   if (written) std::filesystem::rename( writing_path, FilePath, error );
+   const bool stored = written && !error;
+   if (!stored) std::filesystem::remove( writing_path, error );
+   FilePath.clear();
+   return stored;
+}
+
+void StagedFileWriter::abort()
+{
+   commit( false );
+}
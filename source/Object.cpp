@@ -1,7 +1,10 @@
 #include "Object.h"
 
 ObjectGL::ObjectGL() :
-   ImageBuffer( nullptr ), VAO( 0 ), VBO( 0 ), DrawMode( 0 ), VerticesCount( 0 ),
+   ImageBuffer( nullptr ), VAO( 0 ), VBO( 0 ), DrawMode( 0 ), LiveVideoSequence( 0 ),
+   VideoFormat( VideoStream::PixelFormat::BGR ), VideoCompression( BlockFormat::None ), EquiAngularVideo( false ),
+   VideoStepped( false ), CubeLevelsDecoded( false ), CubeLevelsFailed( false ), IsCubeStreaming( false ),
+   StreamedLevel( -1 ), StreamedFace( 0 ), ResidentLevel( 0 ), VerticesCount( 0 ), CubeFaceSize( 0, 0 ), CubeHalfLength( 0.0f ),
    EmissionColor( 0.0f, 0.0f, 0.0f, 1.0f ),
    AmbientReflectionColor( 0.2f, 0.2f, 0.2f, 1.0f ),
    DiffuseReflectionColor( 0.8f, 0.8f, 0.8f, 1.0f ),
@@ -11,6 +14,7 @@ ObjectGL::ObjectGL() :
 
 ObjectGL::~ObjectGL()
 {
+   if (CubeMapWorker.joinable()) CubeMapWorker.join();
    if (VAO != 0) {
       glDeleteVertexArrays( 1, &VAO );
       glDeleteBuffers( 1, &VBO );
@@ -18,6 +22,9 @@ ObjectGL::~ObjectGL()
    for (const auto& texture_id : TextureID) {
       if (texture_id != 0) glDeleteTextures( 1, &texture_id );
    }
+   for (const auto& texture_id : ChromaTextureID) {
+      if (texture_id != 0) glDeleteTextures( 1, &texture_id );
+   }
    for (const auto& buffer : CustomBuffers) {
       if (buffer.second != 0) glDeleteBuffers( 1, &buffer.second );
    }
@@ -297,30 +304,38 @@ void ObjectGL::setObject(
    addTexture( texture_file_path, is_grayscale );
 }
 
-void ObjectGL::prepareCubeTextures(const std::vector<cv::Mat>& cube_image_set)
+GLuint ObjectGL::createCubeTexture(int width, int height, GLenum internal_format, int level_num)
 {
    GLuint texture_id = 0;
    glCreateTextures( GL_TEXTURE_CUBE_MAP, 1, &texture_id );
-   glBindTexture( GL_TEXTURE_CUBE_MAP, texture_id );
-   TextureID.emplace_back( texture_id );
-
+   glTextureStorage2D( texture_id, level_num, internal_format, width, height );
    glTextureParameteri( texture_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
    glTextureParameteri( texture_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
    glTextureParameteri( texture_id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );    
    glTextureParameteri( texture_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTextureParameteri( texture_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTextureParameteri( texture_id, GL_TEXTURE_MIN_FILTER, level_num > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
    glTextureParameteri( texture_id, GL_TEXTURE_BASE_LEVEL, 0 ); 
-   glTextureParameteri( texture_id, GL_TEXTURE_MAX_LEVEL, 0 ); 
-   glGenerateTextureMipmap( texture_id );
+   glTextureParameteri( texture_id, GL_TEXTURE_MAX_LEVEL, level_num - 1 ); 
+   return texture_id;
+}
 
+void ObjectGL::prepareCubeTextures(const std::vector<cv::Mat>& cube_image_set)
+{
+   CubeFaceSize = glm::ivec2(cube_image_set[0].cols, cube_image_set[0].rows);
+   const GLuint texture_id = createCubeTexture( CubeFaceSize.x, CubeFaceSize.y );
+   TextureID.emplace_back( texture_id );
+
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
    for (int i = 0; i < 6; ++i) {
-      glTexImage2D( 
-         GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
+      glTextureSubImage3D( 
+         texture_id, 
+         0, 
+         0, 
          0, 
-         GL_RGB, 
+         i, 
          cube_image_set[i].cols, 
          cube_image_set[i].rows, 
-         0, 
+         1, 
          GL_BGR, 
          GL_UNSIGNED_BYTE, 
          cube_image_set[i].data 
@@ -328,10 +343,290 @@ void ObjectGL::prepareCubeTextures(const std::vector<cv::Mat>& cube_image_set)
    }
 }
 
-void ObjectGL::setCubeObject(
+void ObjectGL::prepareCompressedCubeTextures(const std::vector<cv::Mat>& cube_image_set)
+{
+   CubeFaceSize = glm::ivec2(cube_image_set[0].cols, cube_image_set[0].rows);
+   const GLenum internal_format = BlockCompressor::getInternalFormat( VideoCompression );
+   const GLuint texture_id = createCubeTexture( CubeFaceSize.x, CubeFaceSize.y, internal_format );
+   TextureID.emplace_back( texture_id );
+
+   cv::Mat blocks;
+   for (int i = 0; i < 6; ++i) {
+      BlockCompressor::compress( cube_image_set[i], VideoCompression, blocks );
+      glCompressedTextureSubImage3D(
+         texture_id, 0, 0, 0, i, cube_image_set[i].cols, cube_image_set[i].rows, 1,
+         internal_format, static_cast<GLsizei>(blocks.total()), blocks.data
+      );
+   }
+}
+
+void ObjectGL::loadCubeFaces(const std::vector<std::string>& image_paths, std::vector<std::array<cv::Mat, 6>>& levels)
+{
+   // The faces are uploaded in the order they finish decoding, while the others are still decoding. The storage
+   // is created with the size of the first face to finish, and with room for every mip level.
+   CubeFaceLoader loader;
+   loader.start( image_paths );
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   int face;
+   cv::Mat image;
+   while (loader.takeFace( face, image )) {
+      if (image.empty() || (!TextureID.empty() && (image.cols != CubeFaceSize.x || image.rows != CubeFaceSize.y))) {
+         std::cerr << "Could not read a face of the cube size from " << loader.getImagePath( face ).c_str() << "\n";
+         continue;
+      }
+      if (TextureID.empty()) {
+         CubeFaceSize = glm::ivec2(image.cols, image.rows);
+         TextureID.emplace_back(
+            createCubeTexture( image.cols, image.rows, GL_RGBA8, CubeMapFile::getLevelNum( image.cols, image.rows ) )
+         );
+      }
+
+      const auto upload_start = std::chrono::steady_clock::now();
+      glTextureSubImage3D(
+         TextureID[0], 0, 0, 0, face, image.cols, image.rows, 1, GL_BGR, GL_UNSIGNED_BYTE, image.data
+      );
+      const std::chrono::duration<double, std::milli> upload_time = std::chrono::steady_clock::now() - upload_start;
+      CubeStatistics.DecodeTimes[face] = loader.getFaceTimes( face ).Decode;
+      CubeStatistics.UploadTimes[face] = upload_time.count();
+      CubeStatistics.ReadyTimes[face] = loader.getElapsedTime();
+      levels[0][face] = std::move( image );
+   }
+}
+
+bool ObjectGL::loadCubePreview(const std::vector<std::string>& image_paths)
+{
+   // The storage has room for the whole faces, whose size is read from the JPEG headers, while libjpeg decodes only an
+   // eighth of each face from its DCT coefficients, in a fraction of the time. The reduced faces go to the level of
+   // their size and below, and the cube is drawn from there until the larger levels are in.
+   if (image_paths.size() != 6) return false;
+   const cv::Size face_size = CubeFaceLoader::getJPEGSize( image_paths[0] );
+   if (face_size.empty() || face_size.width != face_size.height) return false;
+   for (const auto& path : image_paths) {
+      if (CubeFaceLoader::getJPEGSize( path ) != face_size) return false;
+   }
+
+   CubeFaceLoader loader;
+   loader.start( image_paths, cv::IMREAD_REDUCED_COLOR_8 );
+   const int level_num = CubeMapFile::getLevelNum( face_size.width, face_size.height );
+   int preview_level = -1;
+   std::vector<std::array<cv::Mat, 6>> levels(1);
+   int face;
+   cv::Mat image;
+   while (loader.takeFace( face, image )) {
+      if (image.empty()) continue;
+      if (preview_level < 0) {
+         preview_level = 0;
+         while (preview_level < level_num - 1 && (face_size.width >> preview_level) > image.cols) preview_level++;
+      }
+      const int size = std::max( face_size.width >> preview_level, 1 );
+      if (image.cols != size || image.rows != size) {
+         cv::resize( image, image, cv::Size(size, size), 0.0, 0.0, cv::INTER_AREA );
+      }
+      cv::cvtColor( image, levels[0][face], cv::COLOR_BGR2BGRA );
+   }
+   const bool complete = std::none_of( levels[0].begin(), levels[0].end(), [](const cv::Mat& face_image) {
+      return face_image.empty();
+   } );
+   if (!complete) return false;
+
+   CubeMipGenerator::addMipLevels( levels );
+   CubeFaceSize = glm::ivec2(face_size.width, face_size.height);
+   TextureID.emplace_back( createCubeTexture( face_size.width, face_size.height, GL_RGBA8, level_num ) );
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   for (int level = 0; level < static_cast<int>(levels.size()); ++level) {
+      for (int i = 0; i < 6; ++i) {
+         const cv::Mat& face_image = levels[level][i];
+         glTextureSubImage3D(
+            TextureID[0], preview_level + level, 0, 0, i, face_image.cols, face_image.rows, 1, GL_BGRA,
+            GL_UNSIGNED_INT_8_8_8_8_REV, face_image.data
+         );
+      }
+   }
+
+   // The levels of the preview are uploaded again from the whole faces, so that they are the ones of the cache.
+   startCubeStream( preview_level, level_num - 1 );
+   return true;
+}
+
+void ObjectGL::decodeCubeLevels(
+   const std::vector<std::string>& image_paths,
+   const cv::Size& face_size,
+   const std::string& cache_path,
+   uint64_t content_hash
+)
+{
+   CubeFaceLoader loader;
+   loader.start( image_paths );
+   std::vector<std::array<cv::Mat, 6>> levels(1);
+   bool complete = true;
+   int face;
+   cv::Mat image;
+   while (loader.takeFace( face, image )) {
+      if (image.empty() || image.size() != face_size) {
+         std::cerr << "Could not read a face of the cube size from " << loader.getImagePath( face ).c_str() << "\n";
+         complete = false;
+         continue;
+      }
+      CubeStatistics.DecodeTimes[face] = loader.getFaceTimes( face ).Decode;
+      cv::cvtColor( image, levels[0][face], cv::COLOR_BGR2BGRA );
+   }
+   if (!complete) {
+      CubeLevelsFailed = true;
+      return;
+   }
+
+   const auto mip_start = std::chrono::steady_clock::now();
+   CubeMipGenerator::addMipLevels( levels );
+   CubeStatistics.MipTime =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mip_start).count();
+
+   // The render thread gets its own headers of the same images, which it can let go of before the cache is written.
+   DecodedCubeLevels = levels;
+   CubeLevelsDecoded = true;
+   if (cache_path.empty()) return;
+
+   if (!CubeMapFile::write( cache_path, content_hash, GL_RGBA8, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, levels )) {
+      std::cerr << "Could not write the cube map to " << cache_path.c_str() << "\n";
+   }
+}
+
+void ObjectGL::uploadCubeMapFile()
+{
+   const cv::Size size = StreamedCubeMap.getFaceSize( 0 );
+   CubeFaceSize = glm::ivec2(size.width, size.height);
+   const int level_num = StreamedCubeMap.getLevelNum();
+   TextureID.emplace_back(
+      createCubeTexture( size.width, size.height, StreamedCubeMap.getInternalFormat(), level_num )
+   );
+
+   // The levels of up to 256 x 256 are uploaded at once to draw the cube with, and the larger ones are left to
+   // updateCubeTexture. The pages of a face are only read while it is uploaded from the mapping.
+   constexpr int preview_size = 256;
+   int preview_level = 0;
+   while (preview_level < level_num - 1) {
+      const cv::Size level_size = StreamedCubeMap.getFaceSize( preview_level );
+      if (std::max( level_size.width, level_size.height ) <= preview_size) break;
+      preview_level++;
+   }
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   for (int face = 0; face < 6; ++face) {
+      const auto upload_start = std::chrono::steady_clock::now();
+      for (int level = preview_level; level < level_num; ++level) uploadStreamedCubeFace( level, face );
+      const auto upload_end = std::chrono::steady_clock::now();
+      CubeStatistics.UploadTimes[face] += std::chrono::duration<double, std::milli>(upload_end - upload_start).count();
+      if (preview_level == 0) {
+         CubeStatistics.ReadyTimes[face] =
+            std::chrono::duration<double, std::milli>(upload_end - CubeLoadStart).count();
+      }
+   }
+   startCubeStream( preview_level, preview_level - 1 );
+}
+
+void ObjectGL::startCubeStream(int resident_level, int first_streamed_level)
+{
+   // Only the levels from the base level down are sampled, so the levels above it can be uploaded while it is drawn.
+   ResidentLevel = resident_level;
+   StreamedLevel = first_streamed_level;
+   StreamedFace = 0;
+   IsCubeStreaming = true;
+   glTextureParameteri( TextureID[0], GL_TEXTURE_BASE_LEVEL, ResidentLevel );
+   CubeStatistics.PreviewLevel = ResidentLevel;
+   CubeStatistics.PreviewTime =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - CubeLoadStart).count();
+}
+
+size_t ObjectGL::uploadStreamedCubeFace(int level, int face)
+{
+   // Compressed faces are uploaded as they are, into the compressed storage.
+   if (StreamedCubeMap.isOpened()) {
+      const cv::Size size = StreamedCubeMap.getFaceSize( level );
+      if (StreamedCubeMap.isCompressed()) {
+         glCompressedTextureSubImage3D(
+            TextureID[0], level, 0, 0, face, size.width, size.height, 1, StreamedCubeMap.getInternalFormat(),
+            static_cast<GLsizei>(StreamedCubeMap.getFaceBytes( level, face )),
+            StreamedCubeMap.getFaceData( level, face )
+         );
+      }
+      else {
+         glTextureSubImage3D(
+            TextureID[0], level, 0, 0, face, size.width, size.height, 1, StreamedCubeMap.getFormat(),
+            StreamedCubeMap.getType(), StreamedCubeMap.getFaceData( level, face )
+         );
+      }
+      return StreamedCubeMap.getFaceBytes( level, face );
+   }
+
+   const cv::Mat& image = DecodedCubeLevels[level][face];
+   glTextureSubImage3D(
+      TextureID[0], level, 0, 0, face, image.cols, image.rows, 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, image.data
+   );
+   return image.total() * image.elemSize();
+}
+
+bool ObjectGL::updateCubeTexture()
+{
+   if (!IsCubeStreaming) return false;
+   if (!StreamedCubeMap.isOpened()) {
+      // When the whole faces cannot be read, the cube stays as it was drawn at first.
+      if (CubeLevelsFailed) {
+         IsCubeStreaming = false;
+         return false;
+      }
+      if (!CubeLevelsDecoded) return false;
+   }
+
+   // A frame uploads up to 16 MiB, which is a face of 2048 x 2048 in RGBA8, but at least a face, so that the larger
+   // levels come in over a few frames without holding any of them up for long. A level is sampled once all of its
+   // faces are in.
+   constexpr size_t frame_budget = 16 << 20;
+   size_t uploaded_bytes = 0;
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   while (StreamedLevel >= 0 && uploaded_bytes < frame_budget) {
+      const auto upload_start = std::chrono::steady_clock::now();
+      uploaded_bytes += uploadStreamedCubeFace( StreamedLevel, StreamedFace );
+      const auto upload_end = std::chrono::steady_clock::now();
+      CubeStatistics.UploadTimes[StreamedFace] +=
+         std::chrono::duration<double, std::milli>(upload_end - upload_start).count();
+      if (StreamedLevel == 0) {
+         CubeStatistics.ReadyTimes[StreamedFace] =
+            std::chrono::duration<double, std::milli>(upload_end - CubeLoadStart).count();
+      }
+      if (++StreamedFace < 6) continue;
+
+      if (StreamedLevel < ResidentLevel) {
+         ResidentLevel = StreamedLevel;
+         glTextureParameteri( TextureID[0], GL_TEXTURE_BASE_LEVEL, ResidentLevel );
+      }
+      StreamedLevel--;
+      StreamedFace = 0;
+   }
+   if (StreamedLevel >= 0) return false;
+
+   IsCubeStreaming = false;
+   StreamedCubeMap.close();
+   DecodedCubeLevels.clear();
+   CubeStatistics.LoadTime =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - CubeLoadStart).count();
+   return true;
+}
+
+void ObjectGL::resetCubeStream()
+{
+   if (CubeMapWorker.joinable()) CubeMapWorker.join();
+   StreamedCubeMap.close();
+   DecodedCubeLevels.clear();
+   CubeLevelsDecoded = false;
+   CubeLevelsFailed = false;
+   IsCubeStreaming = false;
+   CubeStatistics = CubeLoadStatistics();
+   CubeLoadStart = std::chrono::steady_clock::now();
+}
+
+bool ObjectGL::setCubeObject(
    GLenum draw_mode, 
    const std::vector<glm::vec3>& vertices,
-   const std::vector<std::string>& texture_directory_path_set
+   const std::vector<std::string>& texture_directory_path_set,
+   const std::string& cache_directory
 )
 {
    DrawMode = draw_mode;
@@ -344,18 +639,74 @@ void ObjectGL::setCubeObject(
    const int n_bytes_per_vertex = 3 * sizeof(GLfloat);
    prepareVertexBuffer( n_bytes_per_vertex );
 
-   std::vector<cv::Mat> image_set(6);
-   for (int i = 0; i < 6; ++i) {
-      image_set[i] = cv::imread( texture_directory_path_set[i] );
+   resetCubeStream();
+   uint64_t content_hash = 0;
+   std::string cache_path;
+   if (!cache_directory.empty()) {
+      content_hash = CubeMapFile::getContentHash( texture_directory_path_set );
+      cache_path = CubeMapFile::getCachePath( cache_directory, content_hash );
+      if (StreamedCubeMap.open( cache_path, content_hash )) {
+         uploadCubeMapFile();
+         CubeStatistics.Cached = true;
+         return true;
+      }
    }
-   prepareCubeTextures( image_set );
+
+   // The whole faces are decoded after the preview, so that the two do not take the cores from each other.
+   if (loadCubePreview( texture_directory_path_set )) {
+      CubeMapWorker = std::thread(
+         &ObjectGL::decodeCubeLevels, this, texture_directory_path_set, cv::Size(CubeFaceSize.x, CubeFaceSize.y),
+         cache_path, content_hash
+      );
+      return true;
+   }
+
+   // Other images than JPEG have no reduced decoding, so they are loaded whole before the cube is drawn. The faces
+   // read are still drawn when the others cannot be.
+   std::vector<std::array<cv::Mat, 6>> levels(1);
+   loadCubeFaces( texture_directory_path_set, levels );
+   const bool complete = std::none_of( levels[0].begin(), levels[0].end(), [](const cv::Mat& face) {
+      return face.empty();
+   } );
+   if (!complete) {
+      if (!TextureID.empty()) glTextureParameteri( TextureID[0], GL_TEXTURE_MAX_LEVEL, 0 );
+      return false;
+   }
+
+   // The levels below the first are made here rather than by the driver, so that they are averaged across the
+   // edges of the faces and the cache gets the same ones. They are made in BGRA, the layout of the texture.
+   const auto mip_start = std::chrono::steady_clock::now();
+   for (auto& face : levels[0]) cv::cvtColor( face, face, cv::COLOR_BGR2BGRA );
+   CubeMipGenerator::addMipLevels( levels );
+   for (int level = 1; level < static_cast<int>(levels.size()); ++level) {
+      for (int face = 0; face < 6; ++face) {
+         const cv::Mat& image = levels[level][face];
+         glTextureSubImage3D(
+            TextureID[0], level, 0, 0, face, image.cols, image.rows, 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+            image.data
+         );
+      }
+   }
+   const auto end = std::chrono::steady_clock::now();
+   CubeStatistics.MipTime = std::chrono::duration<double, std::milli>(end - mip_start).count();
+   CubeStatistics.LoadTime = std::chrono::duration<double, std::milli>(end - CubeLoadStart).count();
+   CubeStatistics.PreviewTime = CubeStatistics.LoadTime;
+   if (cache_path.empty()) return true;
+
+   // The cube map is written while the scene goes on.
+   CubeMapWorker = std::thread(
+      [levels = std::move( levels ), cache_path, content_hash]() {
+         if (!CubeMapFile::write(
+               cache_path, content_hash, GL_RGBA8, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, levels
+            )) {
+            std::cerr << "Could not write the cube map to " << cache_path.c_str() << "\n";
+         }
+      }
+   );
+   return true;
 }
 
-void ObjectGL::setVideoObject(
-   GLenum draw_mode,
-   const std::vector<glm::vec3>& vertices,
-   const std::vector<std::string>& texture_video_path_set
-)
+bool ObjectGL::setCubeObject(GLenum draw_mode, const std::vector<glm::vec3>& vertices, const std::string& cube_map_path)
 {
    DrawMode = draw_mode;
    for (const auto& vertex : vertices) {
@@ -367,38 +718,628 @@ void ObjectGL::setVideoObject(
    const int n_bytes_per_vertex = 3 * sizeof(GLfloat);
    prepareVertexBuffer( n_bytes_per_vertex );
 
-   Videos.clear();
-   Videos.resize( 6 );
-   for (int i = 0; i < 6; ++i) {
-      Videos[i].open( texture_video_path_set[i] );
+   resetCubeStream();
+   if (!StreamedCubeMap.open( cube_map_path )) {
+      std::cerr << "Could not open the cube map " << cube_map_path.c_str() << "\n";
+      return false;
+   }
+   uploadCubeMapFile();
+   CubeStatistics.Cached = true;
+   return true;
+}
+
+void ObjectGL::setVideoCubeVertices(GLenum draw_mode, const std::vector<glm::vec3>& vertices)
+{
+   DrawMode = draw_mode;
+   for (const auto& vertex : vertices) {
+      DataBuffer.push_back( vertex.x );
+      DataBuffer.push_back( vertex.y );
+      DataBuffer.push_back( vertex.z );
+      CubeHalfLength = std::max( CubeHalfLength, glm::compMax( glm::abs( vertex ) ) );
+      VerticesCount++;
+   }
+   const int n_bytes_per_vertex = 3 * sizeof(GLfloat);
+   prepareVertexBuffer( n_bytes_per_vertex );
+}
+
+void ObjectGL::selectVideoCompression(const std::vector<cv::Mat>& first_frames, BlockFormat compression)
+{
+   // The streams decide the same for themselves, so the textures are compressed only when every stream is.
+   VideoCompression = compression;
+   for (const auto& frame : first_frames) {
+      const cv::Size picture_size = VideoStream::getPictureSize( frame, VideoFormat );
+      if (VideoStream::getCompression( picture_size, VideoFormat, compression ) == BlockFormat::None) {
+         VideoCompression = BlockFormat::None;
+      }
+   }
+   if (compression != BlockFormat::None && !isCompressedVideo()) {
+      std::cerr << "Only BGR videos with sizes that are multiples of 4 are block-compressed\n";
+   }
+}
+
+void ObjectGL::prepareVideoUploadBuffer(const std::vector<cv::Mat>& first_frames)
+{
+   GLsizeiptr slot_size = 0;
+   for (const auto& frame : first_frames) {
+      slot_size = std::max( slot_size, static_cast<GLsizeiptr>(frame.total() * frame.elemSize()) );
+   }
+   VideoUploadBuffer = std::make_unique<UploadBufferGL>();
+   VideoUploadBuffer->setBuffer( slot_size, 2 * static_cast<int>(first_frames.size()) );
+   VideoFrames.clear();
+}
+
+void ObjectGL::addVideoCubeTextures(const cv::Size& picture_size)
+{
+   if (isPlanarVideo()) {
+      TextureID.emplace_back( createCubeTexture( picture_size.width, picture_size.height, GL_R8 ) );
+      ChromaTextureID.emplace_back( createCubeTexture( picture_size.width / 2, picture_size.height / 2, GL_RG8 ) );
+   }
+   else {
+      const GLenum internal_format =
+         isCompressedVideo() ? BlockCompressor::getInternalFormat( VideoCompression ) : GL_RGB8;
+      TextureID.emplace_back( createCubeTexture( picture_size.width, picture_size.height, internal_format ) );
+   }
+}
+
+void ObjectGL::prepareVideoCubeTextures(const std::vector<cv::Mat>& first_frames)
+{
+   if (isCompressedVideo()) {
+      prepareCompressedCubeTextures( first_frames );
+      return;
    }
-   
-   std::vector<cv::Mat> image_set(6);
+   if (!isPlanarVideo()) {
+      prepareCubeTextures( first_frames );
+      return;
+   }
+
+   // The Y plane goes to TextureID and the interleaved UV plane to ChromaTextureID with the same index.
+   const cv::Size picture_size = VideoStream::getPictureSize( first_frames[0], VideoFormat );
+   CubeFaceSize = glm::ivec2(picture_size.width, picture_size.height);
+   addVideoCubeTextures( picture_size );
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
    for (int i = 0; i < 6; ++i) {
-      Videos[i] >> image_set[i];
+      glTextureSubImage3D(
+         TextureID.back(), 0, 0, 0, i, picture_size.width, picture_size.height, 1,
+         GL_RED, GL_UNSIGNED_BYTE, first_frames[i].data
+      );
+      glTextureSubImage3D(
+         ChromaTextureID.back(), 0, 0, 0, i, picture_size.width / 2, picture_size.height / 2, 1,
+         GL_RG, GL_UNSIGNED_BYTE, first_frames[i].ptr<uint8_t>( picture_size.height )
+      );
    }
-   prepareCubeTextures( image_set );
 }
 
-void ObjectGL::updateVideoCubeTextures()
+void ObjectGL::setVideoObject(
+   GLenum draw_mode,
+   const std::vector<glm::vec3>& vertices,
+   const std::vector<std::string>& texture_video_path_set,
+   const VideoSource::Settings& source_settings
+)
 {
-   cv::Mat frame;
-   for (uint i = 0; i < Videos.size(); ++i) {
-      Videos[i] >> frame;
-      if (frame.empty()) continue;
-      glTexSubImage2D(
-         GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-         0, 
-         0, 
-         0, 
-         frame.cols, 
-         frame.rows, 
-         GL_BGR, 
-         GL_UNSIGNED_BYTE, 
-         frame.data
+   setVideoCubeVertices( draw_mode, vertices );
+
+   std::vector<cv::Mat> image_set;
+   Video = std::make_unique<VideoCube>();
+   Video->setSourceSettings( source_settings );
+   VideoFormat = Video->getPixelFormat();
+   if (!Video->open( texture_video_path_set, image_set )) {
+      Video.reset();
+      return;
+   }
+   selectVideoCompression( image_set, source_settings.Compression );
+
+   // TextureID[0] is sampled by the draw while the other one is being written, and they are swapped after uploading.
+   prepareVideoCubeTextures( image_set );
+   prepareVideoCubeTextures( image_set );
+   prepareVideoUploadBuffer( image_set );
+   resetVideoStaleBlocks( image_set, true );
+   Video->play( VideoStepped );
+}
+
+void ObjectGL::setVideoObject(
+   GLenum draw_mode,
+   const std::vector<glm::vec3>& vertices,
+   const std::string& video_path,
+   const VideoSource::Settings& source_settings
+)
+{
+   setVideoCubeVertices( draw_mode, vertices );
+
+   std::vector<cv::Mat> atlas;
+   Video = std::make_unique<VideoCube>();
+   Video->setSourceSettings( source_settings );
+   VideoFormat = Video->getPixelFormat();
+   EquiAngularVideo = source_settings.InputProjection == VideoSource::Projection::EquiAngular3x2;
+   if (!Video->openAtlas( video_path, atlas )) {
+      Video.reset();
+      return;
+   }
+
+   selectVideoCompression( atlas, source_settings.Compression );
+   std::vector<cv::Mat> image_set;
+   CubeFaceRemap::splitAtlas( atlas[0], VideoFormat, image_set );
+   prepareVideoCubeTextures( image_set );
+   prepareVideoCubeTextures( image_set );
+   prepareVideoUploadBuffer( atlas );
+   resetVideoStaleBlocks( atlas, true );
+   Video->play( VideoStepped );
+}
+
+void ObjectGL::setVideoObject(
+   GLenum draw_mode,
+   const std::vector<glm::vec3>& vertices,
+   const std::vector<std::vector<std::string>>& rendition_video_path_sets,
+   const VideoSource::Settings& source_settings
+)
+{
+   setVideoCubeVertices( draw_mode, vertices );
+
+   std::vector<cv::Mat> image_set;
+   Video = std::make_unique<VideoCube>();
+   Video->setSourceSettings( source_settings );
+   VideoFormat = Video->getPixelFormat();
+   if (!Video->openRenditions( rendition_video_path_sets, image_set )) {
+      Video.reset();
+      return;
+   }
+   selectVideoCompression( image_set, source_settings.Compression );
+
+   prepareVideoCubeTextures( image_set );
+   prepareVideoCubeTextures( image_set );
+   prepareVideoUploadBuffer( image_set );
+   resetVideoStaleBlocks( image_set, true );
+   Video->play( VideoStepped );
+}
+
+GLuint ObjectGL::createScaledCubeTexture(
+   GLuint texture_id,
+   const glm::ivec2& size,
+   const glm::ivec2& new_size,
+   GLenum internal_format,
+   const std::array<GLuint, 2>& framebuffers
+)
+{
+   const GLuint scaled_texture_id = createCubeTexture( new_size.x, new_size.y, internal_format );
+   for (int face = 0; face < 6; ++face) {
+      glNamedFramebufferTextureLayer( framebuffers[0], GL_COLOR_ATTACHMENT0, texture_id, 0, face );
+      glNamedFramebufferTextureLayer( framebuffers[1], GL_COLOR_ATTACHMENT0, scaled_texture_id, 0, face );
+      glBlitNamedFramebuffer(
+         framebuffers[0], framebuffers[1],
+         0, 0, size.x, size.y,
+         0, 0, new_size.x, new_size.y,
+         GL_COLOR_BUFFER_BIT, GL_LINEAR
+      );
+   }
+   glDeleteTextures( 1, &texture_id );
+   return scaled_texture_id;
+}
+
+void ObjectGL::resizeVideoCubeTextures(const cv::Size& picture_size)
+{
+   // The shown faces are scaled into the new textures, so nothing pops while the new rendition catches up.
+   const glm::ivec2 new_size(picture_size.width, picture_size.height);
+   const bool planar = isPlanarVideo();
+   std::array<GLuint, 2> framebuffers{};
+   glCreateFramebuffers( 2, framebuffers.data() );
+   for (int i = 0; i < 2; ++i) {
+      TextureID[i] = createScaledCubeTexture(
+         TextureID[i], CubeFaceSize, new_size, planar ? GL_R8 : GL_RGB8, framebuffers
+      );
+      if (planar) {
+         ChromaTextureID[i] = createScaledCubeTexture(
+            ChromaTextureID[i], CubeFaceSize / 2, new_size / 2, GL_RG8, framebuffers
+         );
+      }
+   }
+   glDeleteFramebuffers( 2, framebuffers.data() );
+   CubeFaceSize = new_size;
+}
+
+void ObjectGL::replaceVideoCubeTextures(const std::vector<cv::Mat>& first_frames)
+{
+   // Compressed textures cannot be blitted into, so the new ones start from the first frames of the new rendition.
+   for (const auto& texture_id : TextureID) glDeleteTextures( 1, &texture_id );
+   TextureID.clear();
+   prepareVideoCubeTextures( first_frames );
+   prepareVideoCubeTextures( first_frames );
+}
+
+void ObjectGL::setTiledVideoObject(
+   GLenum draw_mode,
+   const std::vector<glm::vec3>& vertices,
+   const std::vector<std::string>& face_directory_path_set,
+   int tile_num,
+   const VideoSource::Settings& source_settings
+)
+{
+   setVideoCubeVertices( draw_mode, vertices );
+
+   std::vector<cv::Mat> first_frames;
+   Video = std::make_unique<VideoCube>();
+   Video->setSourceSettings( source_settings );
+   VideoFormat = Video->getPixelFormat();
+   if (!Video->openTiled( face_directory_path_set, tile_num, first_frames )) {
+      Video.reset();
+      return;
+   }
+   selectVideoCompression( first_frames, source_settings.Compression );
+
+   // TextureID[0] and TextureID[1] are the base layer, and TextureID[2] and TextureID[3] are the detail layer
+   // that only holds the tiles resident in the last committed set.
+   const std::vector<cv::Mat> base_set(first_frames.begin(), first_frames.begin() + 6);
+   prepareVideoCubeTextures( base_set );
+   prepareVideoCubeTextures( base_set );
+   const cv::Size tile_size = VideoStream::getPictureSize( first_frames.back(), VideoFormat );
+   for (int i = 0; i < 2; ++i) addVideoCubeTextures( tile_size * tile_num );
+   prepareVideoUploadBuffer( first_frames );
+   resetVideoStaleBlocks( first_frames, true );
+   Video->play( VideoStepped );
+}
+
+void ObjectGL::resetVideoStaleBlocks(const std::vector<cv::Mat>& first_frames, bool textures_hold_first_frames)
+{
+   for (auto& stale_blocks : VideoStaleBlocks) {
+      stale_blocks.resize( first_frames.size() );
+      for (size_t i = 0; i < first_frames.size(); ++i) {
+         const bool is_tile = Video != nullptr && Video->getStreamRegion( static_cast<int>(i) ).isTile();
+         const cv::Size picture_size = VideoStream::getPictureSize( first_frames[i], VideoFormat );
+         FrameDelta::markAllBlocksDirty( stale_blocks[i], picture_size );
+         if (textures_hold_first_frames && !is_tile) std::fill( stale_blocks[i].begin(), stale_blocks[i].end(), 0 );
+      }
+   }
+}
+
+GLsizeiptr ObjectGL::uploadVideoRect(
+   GLuint texture_id,
+   uint8_t* slot,
+   GLintptr offset_in_slot,
+   const cv::Mat& plane,
+   const cv::Rect& rect,
+   const cv::Point& offset,
+   int face,
+   GLenum format
+) const
+{
+   const auto row_bytes = static_cast<size_t>(rect.width * plane.elemSize());
+   for (int y = 0; y < rect.height; ++y) {
+      std::memcpy( slot + offset_in_slot + y * row_bytes, plane.ptr<uint8_t>( rect.y + y, rect.x ), row_bytes );
+   }
+   glTextureSubImage3D(
+      texture_id,
+      0,
+      offset.x + rect.x,
+      offset.y + rect.y,
+      face,
+      rect.width,
+      rect.height,
+      1,
+      format,
+      GL_UNSIGNED_BYTE,
+      reinterpret_cast<const void*>(VideoUploadBuffer->getCurrentOffset() + offset_in_slot)
+   );
+   return static_cast<GLsizeiptr>(row_bytes * rect.height);
+}
+
+GLsizeiptr ObjectGL::uploadVideoBlocks(
+   GLuint texture_id,
+   uint8_t* slot,
+   GLintptr offset_in_slot,
+   const cv::Mat& blocks,
+   const cv::Rect& rect,
+   const cv::Point& offset,
+   int face
+) const
+{
+   // The rectangle is aligned to blocks, so each of its rows of blocks is a contiguous run in the block image.
+   const int block_bytes = BlockCompressor::getBlockBytes( VideoCompression );
+   const auto row_bytes = static_cast<size_t>(rect.width / 4 * block_bytes);
+   for (int y = 0; y < rect.height / 4; ++y) {
+      std::memcpy(
+         slot + offset_in_slot + y * row_bytes, blocks.ptr<uint8_t>( rect.y / 4 + y ) + rect.x / 4 * block_bytes,
+         row_bytes
       );
-      
    }
+   const auto size = static_cast<GLsizei>(row_bytes * rect.height / 4);
+   glCompressedTextureSubImage3D(
+      texture_id,
+      0,
+      offset.x + rect.x,
+      offset.y + rect.y,
+      face,
+      rect.width,
+      rect.height,
+      1,
+      BlockCompressor::getInternalFormat( VideoCompression ),
+      size,
+      reinterpret_cast<const void*>(VideoUploadBuffer->getCurrentOffset() + offset_in_slot)
+   );
+   return size;
+}
+
+void ObjectGL::updateVideoFaceAreas(int stream, const cv::Size& picture_size)
+{
+   // A face stream covers its face or a tile of it, and an atlas stream is split into the six faces.
+   VideoFaceAreas.clear();
+   const VideoCube::StreamRegion region = Video != nullptr ? Video->getStreamRegion( stream )
+      : VideoCube::StreamRegion(stream, -1, -1);
+   if (region.isAtlas()) {
+      const int face_size = picture_size.width / 3;
+      for (int i = 0; i < 6; ++i) {
+         VideoFaceAreas.push_back( { i, CubeFaceRemap::getFaceArea( i, face_size ), cv::Point(0, 0) } );
+      }
+   }
+   else {
+      const cv::Point origin = region.isTile()
+         ? cv::Point(region.Column * picture_size.width, region.Row * picture_size.height)
+         : cv::Point(0, 0);
+      VideoFaceAreas.push_back( { region.Face, cv::Rect(cv::Point(0, 0), picture_size), origin } );
+   }
+}
+
+void ObjectGL::uploadVideoFrame(int texture_index, int stream)
+{
+   const cv::Mat& image = VideoFrames[stream].Image;
+   const cv::Mat& blocks = VideoFrames[stream].Blocks;
+   const cv::Size picture_size = VideoStream::getPictureSize( image, VideoFormat );
+   std::vector<uint8_t>& stale_blocks = VideoStaleBlocks[1][stream];
+   const auto frame_size =
+      static_cast<int64_t>(isCompressedVideo() ? blocks.total() : image.total() * image.elemSize());
+   FrameDelta::getDirtyRects( DirtyRects, stale_blocks, picture_size );
+   if (DirtyRects.empty()) {
+      VideoUploadStatistics.SkippedUploadNum++;
+      VideoUploadStatistics.SavedBytes += frame_size;
+      return;
+   }
+
+   // The dirty rectangles are packed one after another in the slot, and each part of them that falls on a face is
+   // uploaded on its own.
+   updateVideoFaceAreas( stream, picture_size );
+   uint8_t* slot = VideoUploadBuffer->acquireSlot();
+   GLintptr offset_in_slot = 0;
+   if (isPlanarVideo()) {
+      // The UV plane has one texel for every 2 x 2 luma texels, and the dirty rectangles are aligned to blocks.
+      const cv::Mat luma = image.rowRange( 0, picture_size.height );
+      const cv::Mat chroma(
+         picture_size.height / 2, picture_size.width / 2, CV_8UC2,
+         const_cast<uint8_t*>(image.ptr<uint8_t>( picture_size.height ))
+      );
+      for (const auto& rect : DirtyRects) {
+         for (const auto& area : VideoFaceAreas) {
+            const cv::Rect part = rect & area.Area;
+            if (part.empty()) continue;
+
+            const cv::Point offset = area.Origin - area.Area.tl();
+            const cv::Rect chroma_part(part.x / 2, part.y / 2, part.width / 2, part.height / 2);
+            offset_in_slot += uploadVideoRect(
+               TextureID[texture_index], slot, offset_in_slot, luma, part, offset, area.Face, GL_RED
+            );
+            offset_in_slot += uploadVideoRect(
+               ChromaTextureID[texture_index], slot, offset_in_slot, chroma, chroma_part, offset / 2, area.Face, GL_RG
+            );
+         }
+      }
+   }
+   else if (isCompressedVideo()) {
+      // The dirty rectangles and the face areas are aligned to 4 x 4 blocks when the sizes are multiples of 4.
+      for (const auto& rect : DirtyRects) {
+         for (const auto& area : VideoFaceAreas) {
+            const cv::Rect part = rect & area.Area;
+            if (part.empty()) continue;
+
+            offset_in_slot += uploadVideoBlocks(
+               TextureID[texture_index], slot, offset_in_slot, blocks, part, area.Origin - area.Area.tl(), area.Face
+            );
+         }
+      }
+   }
+   else {
+      for (const auto& rect : DirtyRects) {
+         for (const auto& area : VideoFaceAreas) {
+            const cv::Rect part = rect & area.Area;
+            if (part.empty()) continue;
+
+            offset_in_slot += uploadVideoRect(
+               TextureID[texture_index], slot, offset_in_slot, image, part, area.Origin - area.Area.tl(), area.Face,
+               GL_BGR
+            );
+         }
+      }
+   }
+   VideoUploadBuffer->releaseSlot();
+   std::fill( stale_blocks.begin(), stale_blocks.end(), 0 );
+   VideoUploadStatistics.UploadedBytes += offset_in_slot;
+   VideoUploadStatistics.SavedBytes += frame_size - offset_in_slot;
+}
+
+void ObjectGL::copyStaleVideoRects(int stream)
+{
+   // The back texture is brought up to the front one where it is stale.
+   const bool is_atlas = Video->getStreamRegion( stream ).isAtlas();
+   const cv::Size picture_size = is_atlas ? CubeFaceRemap::getAtlasSize( CubeFaceSize.x )
+      : cv::Size(CubeFaceSize.x, CubeFaceSize.y);
+   FrameDelta::getDirtyRects( DirtyRects, VideoStaleBlocks[1][stream], picture_size );
+   updateVideoFaceAreas( stream, picture_size );
+   for (const auto& rect : DirtyRects) {
+      for (const auto& area : VideoFaceAreas) {
+         const cv::Rect part = rect & area.Area;
+         if (part.empty()) continue;
+
+         const cv::Point texel = area.Origin + part.tl() - area.Area.tl();
+         glCopyImageSubData(
+            TextureID[0], GL_TEXTURE_CUBE_MAP, 0, texel.x, texel.y, area.Face,
+            TextureID[1], GL_TEXTURE_CUBE_MAP, 0, texel.x, texel.y, area.Face,
+            part.width, part.height, 1
+         );
+         if (isPlanarVideo()) {
+            glCopyImageSubData(
+               ChromaTextureID[0], GL_TEXTURE_CUBE_MAP, 0, texel.x / 2, texel.y / 2, area.Face,
+               ChromaTextureID[1], GL_TEXTURE_CUBE_MAP, 0, texel.x / 2, texel.y / 2, area.Face,
+               part.width / 2, part.height / 2, 1
+            );
+         }
+      }
+   }
+   VideoStaleBlocks[1][stream] = VideoStaleBlocks[0][stream];
+}
+
+void ObjectGL::setLiveVideoObject(
+   GLenum draw_mode,
+   const std::vector<glm::vec3>& vertices,
+   const std::string& ring_name
+)
+{
+   setVideoCubeVertices( draw_mode, vertices );
+
+   LiveVideo = std::make_unique<SharedFrameRing>();
+   if (!LiveVideo->open( ring_name )) {
+      LiveVideo.reset();
+      return;
+   }
+   const SharedFrameRing::Header& header = LiveVideo->getHeader();
+   VideoFormat = header.PixelFormat == 1 ? VideoStream::PixelFormat::NV12 : VideoStream::PixelFormat::BGR;
+   const auto width = static_cast<int>(header.Width);
+   const auto height = static_cast<int>(header.Height);
+   if (header.FaceNum != 6 || (isPlanarVideo() && (width % 2 != 0 || height % 2 != 0))) {
+      std::cerr << "The shared frame ring " << ring_name.c_str() << " does not hold six even-sized cube faces\n";
+      LiveVideo.reset();
+      return;
+   }
+
+   // The faces are black until the first frame is published, with neutral chroma for NV12.
+   std::vector<cv::Mat> first_frames(6);
+   for (auto& frame : first_frames) {
+      if (isPlanarVideo()) {
+         frame = cv::Mat(height * 3 / 2, width, CV_8UC1, cv::Scalar(0));
+         frame.rowRange( height, height * 3 / 2 ).setTo( 128 );
+      }
+      else frame = cv::Mat(height, width, CV_8UC3, cv::Scalar(0, 0, 0));
+   }
+   prepareVideoCubeTextures( first_frames );
+   prepareVideoCubeTextures( first_frames );
+   prepareVideoUploadBuffer( first_frames );
+   VideoFrames.resize( 6 );
+   resetVideoStaleBlocks( first_frames, true );
+}
+
+void ObjectGL::updateLiveVideoCubeTextures()
+{
+   if (!LiveVideo->acquireLatest( LiveVideoSequence )) return;
+
+   // The frames are headers over the shared memory, so the faces are copied only once, into the upload buffer.
+   // The held slot is not written by the producer until it is released.
+   const auto start = std::chrono::steady_clock::now();
+   const SharedFrameRing::Header& header = LiveVideo->getHeader();
+   const auto width = static_cast<int>(header.Width);
+   const auto height = static_cast<int>(header.Height);
+   const int rows = isPlanarVideo() ? height * 3 / 2 : height;
+   const int type = isPlanarVideo() ? CV_8UC1 : CV_8UC3;
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, VideoUploadBuffer->getBuffer() );
+   for (int i = 0; i < 6; ++i) {
+      VideoFrames[i].Image = cv::Mat(rows, width, type, const_cast<uint8_t*>(LiveVideo->getFace( i )));
+      VideoFrames[i].Index = LiveVideo->getHeldSlot().FrameIndex;
+      VideoFrames[i].Timestamp = LiveVideo->getHeldSlot().Timestamp;
+      FrameDelta::markAllBlocksDirty( VideoStaleBlocks[1][i], cv::Size(width, height) );
+      uploadVideoFrame( 1, i );
+      VideoFrames[i].Image.release();
+   }
+   LiveVideo->release();
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+   swapVideoCubeTextures( TextureID );
+   swapVideoCubeTextures( ChromaTextureID );
+   std::swap( VideoStaleBlocks[0], VideoStaleBlocks[1] );
+   const std::chrono::duration<double, std::milli> upload_time = std::chrono::steady_clock::now() - start;
+   VideoUploadStatistics.UploadTime += upload_time.count();
+}
+
+void ObjectGL::updateVideoCubeTextures(const CameraGL* camera)
+{
+   if (LiveVideo != nullptr) {
+      updateLiveVideoCubeTextures();
+      return;
+   }
+   if (Video == nullptr) return;
+
+   std::vector<cv::Mat> first_frames;
+   if (Video->updateRendition( camera->getFOV(), camera->getHeight(), first_frames )) {
+      if (isCompressedVideo()) replaceVideoCubeTextures( first_frames );
+      else resizeVideoCubeTextures( VideoStream::getPictureSize( first_frames[0], VideoFormat ) );
+      prepareVideoUploadBuffer( first_frames );
+      resetVideoStaleBlocks( first_frames, isCompressedVideo() );
+   }
+
+   Video->updateVisibility( camera->getProjectionMatrix() * camera->getViewMatrix(), CubeHalfLength );
+   if (!Video->commitFrames( VideoFrames, UpdatedVideoFaces )) return;
+
+   // VideoStaleBlocks[0] and VideoStaleBlocks[1] are the blocks where the front and the back textures differ from
+   // the last frame taken from each stream. Only the stale blocks of the back texture are uploaded.
+   const auto start = std::chrono::steady_clock::now();
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, VideoUploadBuffer->getBuffer() );
+   for (int i = 0; i < Video->getStreamNum(); ++i) {
+      const VideoCube::StreamRegion& region = Video->getStreamRegion( i );
+      const cv::Mat& image = VideoFrames[i].Image;
+      const auto frame_size = static_cast<GLsizeiptr>(image.total() * image.elemSize());
+      const bool uploadable = frame_size <= VideoUploadBuffer->getSlotSize() && image.isContinuous()
+         && (!isCompressedVideo() || !VideoFrames[i].Blocks.empty());
+      if (!UpdatedVideoFaces[i] || !uploadable) {
+         // A tile without a new frame is not resident, so it does not need to be kept.
+         if (!region.isTile()) copyStaleVideoRects( i );
+
+         // The next frame only marks what changed since this one, so what changed in this one stays stale.
+         if (UpdatedVideoFaces[i]) {
+            for (auto& stale_blocks : VideoStaleBlocks) {
+               FrameDelta::mergeDirtyBlocks( stale_blocks[i], VideoFrames[i].DirtyBlocks );
+            }
+         }
+         continue;
+      }
+
+      for (auto& stale_blocks : VideoStaleBlocks) {
+         FrameDelta::mergeDirtyBlocks( stale_blocks[i], VideoFrames[i].DirtyBlocks );
+      }
+      uploadVideoFrame( region.isTile() ? 3 : 1, i );
+   }
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+   swapVideoCubeTextures( TextureID );
+   swapVideoCubeTextures( ChromaTextureID );
+   std::swap( VideoStaleBlocks[0], VideoStaleBlocks[1] );
+   const std::chrono::duration<double, std::milli> upload_time = std::chrono::steady_clock::now() - start;
+   VideoUploadStatistics.UploadTime += upload_time.count();
+}
+
+void ObjectGL::seekVideo(double time, VideoCube::SeekMode mode) const
+{
+   if (Video != nullptr) Video->seek( time, mode );
+}
+
+void ObjectGL::stepVideo(int64_t index) const
+{
+   if (Video != nullptr) Video->stepTo( index );
+}
+
+bool ObjectGL::hasVideoEnded() const
+{
+   return Video == nullptr || Video->hasEnded();
+}
+
+void ObjectGL::swapVideoCubeTextures(std::vector<GLuint>& texture_ids)
+{
+   if (texture_ids.size() >= 2) std::swap( texture_ids[0], texture_ids[1] );
+   if (texture_ids.size() >= 4) std::swap( texture_ids[2], texture_ids[3] );
+}
+
+void ObjectGL::transferVideoUniformsToShader(const ShaderGL* shader) const
+{
+   const int tile_num = Video != nullptr ? Video->getTileNum() : 0;
+   glUniform1i( shader->getLocation( "UsePlanarYUV" ), isPlanarVideo() ? 1 : 0 );
+   glUniform1i( shader->getLocation( "UseEquiAngular" ), EquiAngularVideo ? 1 : 0 );
+   glUniform1i( shader->getLocation( "TileNum" ), tile_num );
+   if (tile_num == 0) return;
+
+   std::array<GLuint, 6> resident_tile_masks{};
+   for (int i = 0; i < 6; ++i) resident_tile_masks[i] = Video->getResidentTileMask( i );
+   glUniform1uiv( shader->getLocation( "ResidentTileMasks" ), 6, resident_tile_masks.data() );
 }
 
 void ObjectGL::setSquareObject(GLenum draw_mode, bool use_texture)
@@ -0,0 +1,66 @@
+#include "OpenCVVideoSource.h"
+
+OpenCVVideoSource::OpenCVVideoSource() = default;
+
+OpenCVVideoSource::~OpenCVVideoSource()
+{
+   close();
+}
+
+bool OpenCVVideoSource::open(const std::string& video_path, PixelFormat pixel_format)
+{
+   close();
+   if (pixel_format != PixelFormat::BGR) {
+      std::cerr << "OpenCV decodes " << video_path.c_str() << " to BGR only\n";
+      return false;
+   }
+   return Video.open( video_path );
+}
+
+void OpenCVVideoSource::close()
+{
+   if (Video.isOpened()) Video.release();
+}
+
+bool OpenCVVideoSource::read(cv::Mat& image)
+{
+   // VideoCapture demuxes and decodes in grab, and converts to BGR in retrieve.
+   if (!skip()) return false;
+
+   const auto start = std::chrono::steady_clock::now();
+   if (!Video.retrieve( image )) return false;
+   addStageTime( Stage::Convert, start );
+   return true;
+}
+
+bool OpenCVVideoSource::skip()
+{
+   const auto start = std::chrono::steady_clock::now();
+   if (!Video.grab()) return false;
+   addStageTime( Stage::Decode, start );
+   countFrame();
+   return true;
+}
+
+bool OpenCVVideoSource::seek(int64_t frame_index)
+{
+   return Video.set( cv::CAP_PROP_POS_FRAMES, static_cast<double>(frame_index) );
+}
+
+double OpenCVVideoSource::getFPS() const
+{
+   return Video.get( cv::CAP_PROP_FPS );
+}
+
+cv::Size OpenCVVideoSource::getFrameSize() const
+{
+   return {
+      static_cast<int>(Video.get( cv::CAP_PROP_FRAME_WIDTH )),
+      static_cast<int>(Video.get( cv::CAP_PROP_FRAME_HEIGHT ))
+   };
+}
+
+double OpenCVVideoSource::getTimestamp() const
+{
+   return Video.get( cv::CAP_PROP_POS_MSEC );
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "PlaybackClock.h"
+
+PlaybackClock::PlaybackClock() : StartTime( getNow() ), PausedTime( -1.0 )
+{
+}
+
+void PlaybackClock::start()
+{
+   StartTime = getNow();
+   PausedTime = -1.0;
+}
+
+void PlaybackClock::pause(double time)
+{
+   PausedTime = std::max( time, 0.0 );
+}
+
+void PlaybackClock::resume()
+{
+   if (!isPaused()) return;
+
+   const std::chrono::duration<double, std::milli> paused_time(PausedTime.load());
+   StartTime = getNow() - std::chrono::duration_cast<std::chrono::steady_clock::duration>( paused_time ).count();
+   PausedTime = -1.0;
+}
+
+double PlaybackClock::getTime() const
+{
+   const double paused_time = PausedTime;
+   if (paused_time >= 0.0) return paused_time;
+
+   const std::chrono::steady_clock::duration elapsed(getNow() - StartTime);
+   return std::chrono::duration<double, std::milli>(elapsed).count();
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "PooledMatAllocator.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+PooledMatAllocator::PooledMatAllocator() :
+   UseHugePages( false ), PooledByteLimit( 1LL << 30 ), FreeLists( 4 * 64 )
+{
+}
+
+PooledMatAllocator* PooledMatAllocator::getInstance()
+{
+   static auto* instance = new PooledMatAllocator();
+   return instance;
+}
+
+int PooledMatAllocator::getSizeClass(size_t size)
+{
+   // The classes between 2^k and 2^(k + 1) are 2^k * 5 / 4, 6 / 4, 7 / 4 and 8 / 4, starting from 2^12.
+   int k = 0;
+   while ((size - 1) >> (k + 1)) k++;
+   const size_t base = size_t(1) << k;
+   const size_t quarter = base / 4;
+   const auto steps = static_cast<int>((size - base + quarter - 1) / quarter);
+   return (k - 12) * 4 + steps - 1;
+}
+
+size_t PooledMatAllocator::getClassSize(int size_class)
+{
+   const size_t base = size_t(1) << (size_class / 4 + 12);
+   return base + base / 4 * (size_class % 4 + 1);
+}
+
+uint8_t* PooledMatAllocator::allocateBuffer(size_t size, size_t alignment, bool huge_pages) const
+{
+#ifdef _WIN32
+   auto* buffer = static_cast<uint8_t*>(_aligned_malloc( size, alignment ));
+#else
+   void* memory = nullptr;
+   auto* buffer = posix_memalign( &memory, alignment, size ) == 0 ? static_cast<uint8_t*>(memory) : nullptr;
+#endif
+   if (buffer == nullptr) CV_Error( cv::Error::StsNoMem, "The pixel buffer pool is out of memory" );
+
+#ifdef __linux__
+   if (huge_pages && madvise( buffer, size, MADV_HUGEPAGE ) == 0) {
+      std::lock_guard<std::mutex> lock(Lock);
+      PoolStatistics.HugePageBytes += static_cast<int64_t>(size);
+   }
+#endif
+   return buffer;
+}
+
+void PooledMatAllocator::freeBuffer(uint8_t* buffer)
+{
+#ifdef _WIN32
+   _aligned_free( buffer );
+#else
+   free( buffer );
+#endif
+}
+
+void PooledMatAllocator::updatePeakBytes() const
+{
+   PoolStatistics.PeakBytes =
+      std::max( PoolStatistics.PeakBytes, PoolStatistics.UsedBytes + PoolStatistics.PooledBytes );
+}
+
+cv::UMatData* PooledMatAllocator::allocate(
+   int dims,
+   const int* sizes,
+   int type,
+   void* data,
+   size_t* step,
+   cv::AccessFlag /*flags*/,
+   cv::UMatUsageFlags /*usage_flags*/
+) const
+{
+   // The steps and the user data are handled as cv::Mat's own allocator does.
+   size_t total = CV_ELEM_SIZE( type );
+   for (int i = dims - 1; i >= 0; --i) {
+      if (step != nullptr) {
+         if (data != nullptr && step[i] != cv::Mat::AUTO_STEP) {
+            CV_Assert( total <= step[i] );
+            total = step[i];
+         }
+         else step[i] = total;
+      }
+      total *= sizes[i];
+   }
+
+   auto* u = new cv::UMatData(this);
+   u->size = total;
+   u->allocatorFlags_ = -1;
+   if (data != nullptr) {
+      u->data = u->origdata = static_cast<uchar*>(data);
+      u->flags |= cv::UMatData::USER_ALLOCATED;
+      return u;
+   }
+   if (total <= MinPooledSize) {
+      u->data = u->origdata = allocateBuffer( std::max( total, size_t(1) ), SimdAlignment, false );
+      return u;
+   }
+
+   const int size_class = getSizeClass( total );
+   const size_t class_size = getClassSize( size_class );
+   uint8_t* buffer = nullptr;
+   {
+      std::lock_guard<std::mutex> lock(Lock);
+      PoolStatistics.AllocationNum++;
+      PoolStatistics.UsedBytes += static_cast<int64_t>(class_size);
+      std::vector<uint8_t*>& free_list = FreeLists[size_class];
+      if (!free_list.empty()) {
+         buffer = free_list.back();
+         free_list.pop_back();
+         PoolStatistics.PoolHitNum++;
+         PoolStatistics.PooledBytes -= static_cast<int64_t>(class_size);
+      }
+      updatePeakBytes();
+   }
+   if (buffer == nullptr) {
+      const bool huge_pages = UseHugePages && class_size >= HugePageSize;
+      buffer = allocateBuffer( class_size, huge_pages ? HugePageSize : PageSize, huge_pages );
+   }
+   u->data = u->origdata = buffer;
+   u->allocatorFlags_ = size_class;
+   return u;
+}
+
+bool PooledMatAllocator::allocate(
+   cv::UMatData* data,
+   cv::AccessFlag /*access_flags*/,
+   cv::UMatUsageFlags /*usage_flags*/
+) const
+{
+   return data != nullptr;
+}
+
+void PooledMatAllocator::deallocate(cv::UMatData* data) const
+{
+   if (data == nullptr) return;
+
+   CV_Assert( data->urefcount == 0 && data->refcount == 0 );
+   if (!(data->flags & cv::UMatData::USER_ALLOCATED)) {
+      auto* buffer = static_cast<uint8_t*>(data->origdata);
+      const int size_class = data->allocatorFlags_;
+      bool pooled = false;
+      if (size_class >= 0) {
+         const size_t class_size = getClassSize( size_class );
+         std::lock_guard<std::mutex> lock(Lock);
+         PoolStatistics.UsedBytes -= static_cast<int64_t>(class_size);
+         if (PoolStatistics.PooledBytes + static_cast<int64_t>(class_size) <= PooledByteLimit) {
+            FreeLists[size_class].emplace_back( buffer );
+            PoolStatistics.PooledBytes += static_cast<int64_t>(class_size);
+            pooled = true;
+         }
+      }
+      if (!pooled) freeBuffer( buffer );
+      data->origdata = nullptr;
+   }
+   delete data;
+}
+
+void PooledMatAllocator::setPooledByteLimit(int64_t limit)
+{
+   {
+      std::lock_guard<std::mutex> lock(Lock);
+      PooledByteLimit = limit;
+      if (PoolStatistics.PooledBytes <= PooledByteLimit) return;
+   }
+   trim();
+}
+
+void PooledMatAllocator::trim()
+{
+   std::vector<uint8_t*> buffers;
+   {
+      std::lock_guard<std::mutex> lock(Lock);
+      for (auto& free_list : FreeLists) {
+         buffers.insert( buffers.end(), free_list.begin(), free_list.end() );
+         free_list.clear();
+      }
+      PoolStatistics.PooledBytes = 0;
+   }
+   for (auto* buffer : buffers) freeBuffer( buffer );
+}
+
+PooledMatAllocator::Statistics PooledMatAllocator::getStatistics() const
+{
+   std::lock_guard<std::mutex> lock(Lock);
+   return PoolStatistics;
+}
\ No newline at end of file
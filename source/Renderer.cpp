@@ -1,12 +1,20 @@
 #include "Renderer.h"
 
 RendererGL::RendererGL() : 
-   Window( nullptr ), FrameWidth( 1920 ), FrameHeight( 1080 ), IsVideo( false ), ClickedPoint( -1, -1 ),
+   Window( nullptr ), FrameWidth( 1920 ), FrameHeight( 1080 ), IsVideo( false ), VideoTileNum( 0 ),
+   ClickedPoint( -1, -1 ),
    MainCamera( std::make_unique<CameraGL>() ), ObjectShader( std::make_unique<ShaderGL>() ),
-   CubeObject( std::make_unique<ObjectGL>() )
+   CubeObject( std::make_unique<ObjectGL>() ), Recorder( std::make_unique<FrameRecorderGL>() ),
+   RecordingFPS( 30.0 )
 {
    Renderer = this;
 
+   std::error_code error;
+   const std::filesystem::path temporary_directory = std::filesystem::temp_directory_path( error );
+   if (!error) CubeCacheDirectory = (temporary_directory / "CubeMapping" / "cubemaps").string();
+
+   // The decoded frames and the loaded images reuse the buffers of the released ones.
+   cv::Mat::setDefaultAllocator( PooledMatAllocator::getInstance() );
    initialize();
    printOpenGLInformation();
 }
@@ -48,6 +56,7 @@ void RendererGL::initialize()
    registerCallbacks();
    
    glEnable( GL_DEPTH_TEST );
+   glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
    glClearColor( 1.0f, 1.0f, 1.0f, 1.0f );
 
    MainCamera->updateWindowSize( FrameWidth, FrameHeight );
@@ -109,6 +118,43 @@ void RendererGL::keyboard(GLFWwindow* window, int key, int scancode, int action,
          const glm::vec3 pos = MainCamera->getCameraPosition();
          std::cout << "Camera Position: " << pos.x << ", " << pos.y << ", " << pos.z << "\n";
       } break;
+      case GLFW_KEY_V: {
+         const PooledMatAllocator::Statistics pool = PooledMatAllocator::getInstance()->getStatistics();
+         std::cout << "Pixel Buffers: " << pool.AllocationNum << " allocations (from the pool: " << pool.PoolHitNum
+            << ", used: " << pool.UsedBytes << " bytes, pooled: " << pool.PooledBytes << " bytes, peak: "
+            << pool.PeakBytes << " bytes)\n";
+         const VideoCube* video = CubeObject->getVideo();
+         if (video == nullptr) break;
+         const VideoCube::DriftStatistics& drift = video->getDriftStatistics();
+         std::cout << "Video Frame: " << video->getCommittedIndex() << " (committed sets: " << drift.CommittedSetNum
+            << ", held sets: " << drift.HeldSetNum << ", discarded frames: " << drift.DiscardedFrameNum
+            << ", drift: " << drift.CurrentDrift << ", max drift: " << drift.MaxDrift
+            << ", visible streams: " << video->getVisibleStreamNum() << ")\n";
+         const ObjectGL::UploadStatistics& upload = CubeObject->getVideoUploadStatistics();
+         std::cout << "Video Upload: " << upload.UploadedBytes << " bytes (saved: " << upload.SavedBytes
+            << " bytes, unchanged frames: " << upload.SkippedUploadNum << ")\n";
+      } break;
+      case GLFW_KEY_R: {
+         if (Recorder->isRecording()) {
+            Recorder->stop();
+            break;
+         }
+         int width, height;
+         glfwGetFramebufferSize( window, &width, &height );
+         const std::string video_path = std::string(CMAKE_SOURCE_DIR) + "/recording.avi";
+         if (Recorder->start( video_path, width, height, RecordingFPS )) {
+            std::cout << "Recording " << width << "x" << height << " frames to " << video_path.c_str() << "\n";
+         }
+      } break;
+      case GLFW_KEY_COMMA:
+      case GLFW_KEY_PERIOD: {
+         // Each press scrubs by a second, and the shown keyframes are refined once the presses stop. Videos without
+         // keyframes are sought to the exact frames.
+         const VideoCube* video = CubeObject->getVideo();
+         if (video == nullptr) break;
+         const double step = key == GLFW_KEY_COMMA ? -1000.0 : 1000.0;
+         CubeObject->seekVideo( video->getTime() + step, VideoCube::SeekMode::Keyframe );
+      } break;
       case GLFW_KEY_Q:
       case GLFW_KEY_ESCAPE:
          cleanupWrapper( window );
@@ -199,7 +245,7 @@ void RendererGL::registerCallbacks() const
    glfwSetFramebufferSizeCallback( Window, reshapeWrapper );
 }
 
-void RendererGL::setCubeObject(float length) const
+void RendererGL::setCubeObject(float length)
 {
    const std::vector<glm::vec3> cube_vertices{
       { -length, length, -length },
@@ -246,50 +292,111 @@ void RendererGL::setCubeObject(float length) const
    };
 
    const std::string sample_directory_path = std::string(CMAKE_SOURCE_DIR) + "/samples";
+   const std::string video_path = VideoPath.empty() ? sample_directory_path + "/dynamic" : VideoPath;
    std::vector<std::string> texture_set;
-   if (IsVideo) {
-      const std::string texture_set_path = std::string(sample_directory_path + "/dynamic");
+   if (IsVideo && !LiveVideoRing.empty()) {
+      CubeObject->setLiveVideoObject( GL_TRIANGLES, cube_vertices, LiveVideoRing );
+   }
+   else if (IsVideo && VideoSettings.InputProjection != VideoSource::Projection::Cube) {
+      CubeObject->setVideoObject( GL_TRIANGLES, cube_vertices, video_path, VideoSettings );
+   }
+   else if (IsVideo && VideoTileNum > 0) {
       texture_set = {
-         std::string(texture_set_path + "/right.avi"),
-         std::string(texture_set_path + "/left.avi"),
-         std::string(texture_set_path + "/top.avi"),
-         std::string(texture_set_path + "/bottom.avi"),
-         std::string(texture_set_path + "/back.avi"),
-         std::string(texture_set_path + "/front.avi")
+         std::string(video_path + "/right"),
+         std::string(video_path + "/left"),
+         std::string(video_path + "/top"),
+         std::string(video_path + "/bottom"),
+         std::string(video_path + "/back"),
+         std::string(video_path + "/front")
       };
-      CubeObject->setVideoObject( GL_TRIANGLES, cube_vertices, texture_set );
+      CubeObject->setTiledVideoObject( GL_TRIANGLES, cube_vertices, texture_set, VideoTileNum, VideoSettings );
    }
-   else {
-      const std::string texture_set_path = std::string(sample_directory_path + "/static/sample1");
+   else if (IsVideo) {
       texture_set = {
-         std::string(texture_set_path + "/right.jpg"),
-         std::string(texture_set_path + "/left.jpg"),
-         std::string(texture_set_path + "/top.jpg"),
-         std::string(texture_set_path + "/bottom.jpg"),
-         std::string(texture_set_path + "/back.jpg"),
-         std::string(texture_set_path + "/front.jpg")
+         std::string(video_path + "/right.avi"),
+         std::string(video_path + "/left.avi"),
+         std::string(video_path + "/top.avi"),
+         std::string(video_path + "/bottom.avi"),
+         std::string(video_path + "/back.avi"),
+         std::string(video_path + "/front.avi")
       };
-      CubeObject->setCubeObject( GL_TRIANGLES, cube_vertices, texture_set );
+      CubeObject->setVideoObject( GL_TRIANGLES, cube_vertices, texture_set, VideoSettings );
+   }
+   else {
+      // A cube map file that cannot be loaded gives way to the sample faces, on an object of their own.
+      bool loaded = !CubeMapPath.empty() && CubeObject->setCubeObject( GL_TRIANGLES, cube_vertices, CubeMapPath );
+      if (!loaded && !CubeMapPath.empty()) {
+         std::cerr << "Could not load the cube map " << CubeMapPath.c_str() << ", so the sample faces are shown\n";
+         CubeObject = std::make_unique<ObjectGL>();
+         CubeMapPath.clear();
+      }
+      if (!loaded) {
+         const std::string texture_set_path = std::string(sample_directory_path + "/static/sample1");
+         texture_set = {
+            std::string(texture_set_path + "/right.jpg"),
+            std::string(texture_set_path + "/left.jpg"),
+            std::string(texture_set_path + "/top.jpg"),
+            std::string(texture_set_path + "/bottom.jpg"),
+            std::string(texture_set_path + "/back.jpg"),
+            std::string(texture_set_path + "/front.jpg")
+         };
+         loaded = CubeObject->setCubeObject( GL_TRIANGLES, cube_vertices, texture_set, CubeCacheDirectory );
+      }
+
+      const ObjectGL::CubeLoadStatistics& statistics = CubeObject->getCubeLoadStatistics();
+      if (!loaded) std::cerr << "Could not load the faces of the cube\n";
+      else if (CubeObject->isCubeStreaming()) {
+         std::cout << "Cube: drawn from level " << statistics.PreviewLevel << " in " << statistics.PreviewTime
+            << " ms, loading the rest\n";
+      }
+      else printCubeLoadStatistics();
    }
    CubeObject->setDiffuseReflectionColor( { 1.0f, 1.0f, 1.0f, 1.0f } );
 }
 
+void RendererGL::printCubeLoadStatistics() const
+{
+   const ObjectGL::CubeLoadStatistics& statistics = CubeObject->getCubeLoadStatistics();
+   if (!CubeMapPath.empty()) {
+      std::cout << "Cube Map: loaded in " << statistics.LoadTime << " ms from " << CubeMapPath.c_str() << "\n";
+      return;
+   }
 
-void RendererGL::drawCubeObject() const
+   double decode_time = 0.0;
+   for (const auto& time : statistics.DecodeTimes) decode_time += time;
+   std::cout << "Cube Faces: loaded in " << statistics.LoadTime << " ms "
+      << (statistics.Cached ? "from the cache" : "from the images") << " (decoding: " << decode_time
+      << " ms in total, mip levels: " << statistics.MipTime << " ms)\n";
+   const std::array<const char*, 6> face_names{ "right", "left", "top", "bottom", "back", "front" };
+   for (int i = 0; i < 6; ++i) {
+      std::cout << " - " << face_names[i] << ": decoded in " << statistics.DecodeTimes[i] << " ms, uploaded in "
+         << statistics.UploadTimes[i] << " ms, ready at " << statistics.ReadyTimes[i] << " ms\n";
+   }
+}
+
+void RendererGL::drawCubeObject(GLuint framebuffer, int width, int height) const
 {
-   MainCamera->updateWindowSize( FrameWidth, FrameHeight );
-   glViewport( 0, 0, FrameWidth, FrameHeight );
+   MainCamera->updateWindowSize( width, height );
+   glViewport( 0, 0, width, height );
 
-   glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   glBindFramebuffer( GL_FRAMEBUFFER, framebuffer );
    glUseProgram( ObjectShader->getShaderProgram() );
    
    glUseProgram( ObjectShader->getShaderProgram() );
    ObjectShader->transferBasicTransformationUniforms( glm::mat4(1.0f), MainCamera.get(), true );
 
-   if (IsVideo) CubeObject->updateVideoCubeTextures();
+   if (IsVideo) CubeObject->updateVideoCubeTextures( MainCamera.get() );
+   else if (CubeObject->updateCubeTexture()) printCubeLoadStatistics();
    CubeObject->transferUniformsToShader( ObjectShader.get() );
+   CubeObject->transferVideoUniformsToShader( ObjectShader.get() );
+
+   // A cube that could not be loaded has no texture to draw with.
+   if (CubeObject->getTextureNum() == 0) return;
 
    glBindTextureUnit( 0, CubeObject->getTextureID( 0 ) );
+   if (CubeObject->getTextureNum() > 2) glBindTextureUnit( 1, CubeObject->getTextureID( 2 ) );
+   if (CubeObject->getChromaTextureNum() > 0) glBindTextureUnit( 2, CubeObject->getChromaTextureID( 0 ) );
+   if (CubeObject->getChromaTextureNum() > 2) glBindTextureUnit( 3, CubeObject->getChromaTextureID( 2 ) );
    glBindVertexArray( CubeObject->getVAO() );
    glDrawArrays( CubeObject->getDrawMode(), 0, CubeObject->getVertexNum() );
 }
@@ -298,24 +405,123 @@ void RendererGL::render() const
 {
    glClear( OPENGL_COLOR_BUFFER_BIT | OPENGL_DEPTH_BUFFER_BIT );
 
-   drawCubeObject();
+   drawCubeObject( 0, FrameWidth, FrameHeight );
 
    glBindVertexArray( 0 );
    glUseProgram( 0 );
 }
 
-void RendererGL::play()
+void RendererGL::prepareScene()
 {
    if (glfwWindowShouldClose( Window )) initialize();
 
    setCubeObject( 5.0f );
    ObjectShader->setUniformLocations( 0 );
+   ObjectShader->addUniformLocation( "UsePlanarYUV" );
+   ObjectShader->addUniformLocation( "UseEquiAngular" );
+   ObjectShader->addUniformLocation( "TileNum" );
+   ObjectShader->addUniformLocation( "ResidentTileMasks" );
+}
+
+void RendererGL::setVideo(const std::string& video_path, const VideoSource::Settings& settings, int tile_num)
+{
+   IsVideo = true;
+   VideoPath = video_path;
+   VideoSettings = settings;
+   VideoTileNum = tile_num;
+}
+
+void RendererGL::setLiveVideo(const std::string& ring_name)
+{
+   IsVideo = true;
+   LiveVideoRing = ring_name;
+}
+
+void RendererGL::setCubeMap(const std::string& cube_map_path)
+{
+   CubeMapPath = cube_map_path;
+}
+
+void RendererGL::play()
+{
+   prepareScene();
 
    while (!glfwWindowShouldClose( Window )) {
       render();
+      if (Recorder->isRecording()) {
+         int width, height;
+         glfwGetFramebufferSize( Window, &width, &height );
+         Recorder->capture( width, height );
+      }
 
       glfwSwapBuffers( Window );
       glfwPollEvents();
    }
+   Recorder->stop();
+   glfwDestroyWindow( Window );
+}
+
+bool RendererGL::renderOffline(const std::string& camera_path, const std::string& video_path, int width, int height)
+{
+   CameraPath path;
+   if (!path.load( camera_path )) return false;
+
+   // The clock of the video never runs, so no frame becomes overdue while the scene is still being prepared.
+   IsVideo = true;
+   CubeObject->setVideoStepped( true );
+   prepareScene();
+   const VideoCube* video = CubeObject->getVideo();
+   if (video == nullptr) {
+      std::cerr << "Offline rendering needs a cube video\n";
+      glfwDestroyWindow( Window );
+      return false;
+   }
+
+   // The frames are rendered into an offscreen framebuffer and never presented, so nothing waits for vsync.
+   GLuint framebuffer, color_buffer, depth_buffer;
+   glCreateFramebuffers( 1, &framebuffer );
+   glCreateRenderbuffers( 1, &color_buffer );
+   glCreateRenderbuffers( 1, &depth_buffer );
+   glNamedRenderbufferStorage( color_buffer, GL_RGB8, width, height );
+   glNamedRenderbufferStorage( depth_buffer, GL_DEPTH_COMPONENT24, width, height );
+   glNamedFramebufferRenderbuffer( framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer );
+   glNamedFramebufferRenderbuffer( framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer );
+
+   // The decoders work ahead of the frame being rendered, and the recorder reads back and encodes the previous
+   // frames behind it, so each frame only waits for the slowest of these stages.
+   const double frame_duration = video->getFrameDuration();
+   const bool recording = Recorder->start( video_path, width, height, 1000.0 / frame_duration, true );
+   const auto start_time = std::chrono::steady_clock::now();
+   int64_t index = 0;
+   CubeObject->stepVideo( index );
+   while (recording && !glfwWindowShouldClose( Window )) {
+      path.apply( MainCamera.get(), static_cast<double>(index) * frame_duration );
+      while (video->getCommittedIndex() < index && !CubeObject->hasVideoEnded()) {
+         MainCamera->updateWindowSize( width, height );
+         CubeObject->updateVideoCubeTextures( MainCamera.get() );
+         if (video->getCommittedIndex() < index) std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+      }
+      if (video->getCommittedIndex() < index) break;
+
+      glBindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+      glClear( OPENGL_COLOR_BUFFER_BIT | OPENGL_DEPTH_BUFFER_BIT );
+      drawCubeObject( framebuffer, width, height );
+      glBindVertexArray( 0 );
+      glUseProgram( 0 );
+      Recorder->capture( width, height, framebuffer );
+      glfwPollEvents();
+
+      CubeObject->stepVideo( ++index );
+   }
+   Recorder->stop();
+   const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+   std::cout << "Rendered " << index << " frames in " << elapsed.count() << " s ("
+      << static_cast<double>(index) / std::max( elapsed.count(), 1e-6 ) << " fps)\n";
+
+   glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   glDeleteFramebuffers( 1, &framebuffer );
+   glDeleteRenderbuffers( 1, &color_buffer );
+   glDeleteRenderbuffers( 1, &depth_buffer );
    glfwDestroyWindow( Window );
+   return recording;
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "SharedFrameRing.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+// The atomics are shared by two processes, which only works for lock-free ones.
+static_assert( std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free );
+
+SharedFrameRing::SharedFrameRing() :
+   Owner( false ), Data( nullptr ), Size( 0 ), RingHeader( nullptr ), WritingSlot( 0 ), HeldSlot( 0 )
+{
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+   close();
+}
+
+#ifdef __linux__
+bool SharedFrameRing::map(int descriptor, size_t size)
+{
+   void* data = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0 );
+   ::close( descriptor );
+   if (data == MAP_FAILED) return false;
+
+   Data = static_cast<uint8_t*>(data);
+   Size = size;
+   RingHeader = reinterpret_cast<Header*>(Data);
+   return true;
+}
+
+bool SharedFrameRing::create(
+   const std::string& name,
+   int face_num,
+   int slot_num,
+   int width,
+   int height,
+   uint32_t pixel_format,
+   double fps
+)
+{
+   close();
+   if (slot_num < 3 || face_num < 1 || width <= 0 || height <= 0) return false;
+
+   constexpr uint64_t page_size = 4096;
+   const auto align = [](uint64_t size) { return (size + page_size - 1) / page_size * page_size; };
+   const uint64_t face_stride = getFaceSize( width, height, pixel_format );
+   const uint64_t slot_stride = align( face_stride * face_num );
+   const uint64_t data_offset = align( sizeof( Header ) + sizeof( Slot ) * slot_num );
+   const uint64_t size = data_offset + slot_stride * slot_num;
+
+   const int descriptor = shm_open( name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600 );
+   if (descriptor < 0) return false;
+   if (ftruncate( descriptor, static_cast<off_t>(size) ) != 0) {
+      ::close( descriptor );
+      shm_unlink( name.c_str() );
+      return false;
+   }
+   if (!map( descriptor, size )) {
+      shm_unlink( name.c_str() );
+      return false;
+   }
+
+   Name = name;
+   Owner = true;
+   new (RingHeader) Header{};
+   std::memcpy( RingHeader->Magic, "CMRING", 6 );
+   RingHeader->Version = CurrentVersion;
+   RingHeader->FaceNum = static_cast<uint32_t>(face_num);
+   RingHeader->SlotNum = static_cast<uint32_t>(slot_num);
+   RingHeader->Width = static_cast<uint32_t>(width);
+   RingHeader->Height = static_cast<uint32_t>(height);
+   RingHeader->PixelFormat = pixel_format;
+   RingHeader->FaceStride = face_stride;
+   RingHeader->SlotStride = slot_stride;
+   RingHeader->SlotTableOffset = sizeof( Header );
+   RingHeader->DataOffset = data_offset;
+   RingHeader->FPS = fps;
+   RingHeader->LatestSlot = static_cast<uint32_t>(slot_num);
+   RingHeader->ReaderSlot = static_cast<uint32_t>(slot_num);
+   RingHeader->Notification = 0;
+   RingHeader->PublishedNum = 0;
+   return true;
+}
+
+bool SharedFrameRing::open(const std::string& name)
+{
+   close();
+   const int descriptor = shm_open( name.c_str(), O_RDWR, 0 );
+   if (descriptor < 0) {
+      std::cerr << "Could not open the shared frame ring " << name.c_str() << "\n";
+      return false;
+   }
+   struct stat status{};
+   if (fstat( descriptor, &status ) != 0 || static_cast<size_t>(status.st_size) < sizeof( Header )) {
+      ::close( descriptor );
+      return false;
+   }
+   if (!map( descriptor, static_cast<size_t>(status.st_size) )) return false;
+
+   const Header& header = *RingHeader;
+   const bool valid =
+      std::memcmp( header.Magic, "CMRING", 6 ) == 0 && header.Version == CurrentVersion && header.SlotNum >= 3 &&
+      header.FaceStride >= getFaceSize( header.Width, header.Height, header.PixelFormat ) &&
+      header.DataOffset + static_cast<uint64_t>(header.SlotNum) * header.SlotStride <= Size;
+   if (!valid) {
+      std::cerr << "The shared memory object " << name.c_str() << " is not a frame ring of version "
+         << CurrentVersion << "\n";
+      close();
+      return false;
+   }
+   Name = name;
+   HeldSlot = header.SlotNum;
+   return true;
+}
+
+void SharedFrameRing::close()
+{
+   if (Data == nullptr) return;
+
+   if (!Owner && RingHeader->ReaderSlot == HeldSlot) RingHeader->ReaderSlot = RingHeader->SlotNum;
+   munmap( Data, Size );
+   if (Owner) shm_unlink( Name.c_str() );
+   Data = nullptr;
+   RingHeader = nullptr;
+   Size = 0;
+   Owner = false;
+}
+
+uint8_t* SharedFrameRing::beginWrite()
+{
+   // With 3 slots or more, one is always neither the latest nor the one being read.
+   const uint32_t latest = RingHeader->LatestSlot;
+   const uint32_t reader = RingHeader->ReaderSlot;
+   do {
+      WritingSlot = (WritingSlot + 1) % RingHeader->SlotNum;
+   } while (WritingSlot == latest || WritingSlot == reader);
+   return Data + RingHeader->DataOffset + WritingSlot * RingHeader->SlotStride;
+}
+
+void SharedFrameRing::publish(int64_t frame_index, double timestamp)
+{
+   Slot& slot = getSlotTable()[WritingSlot];
+   slot.Sequence = RingHeader->PublishedNum;
+   slot.FrameIndex = frame_index;
+   slot.Timestamp = timestamp;
+   RingHeader->LatestSlot = WritingSlot;
+   RingHeader->PublishedNum++;
+   RingHeader->Notification++;
+   syscall( SYS_futex, &RingHeader->Notification, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0 );
+}
+
+bool SharedFrameRing::acquireLatest(uint64_t& last_sequence)
+{
+   // A slot is held only when it was still the latest after announcing it. Otherwise the producer might have
+   // chosen it before seeing the announcement.
+   uint32_t latest;
+   do {
+      latest = RingHeader->LatestSlot;
+      if (latest >= RingHeader->SlotNum) return false;
+      RingHeader->ReaderSlot = latest;
+   } while (RingHeader->LatestSlot != latest);
+
+   const uint64_t sequence = getSlotTable()[latest].Sequence;
+   if (HeldSlot == latest && sequence == last_sequence) return false;
+
+   HeldSlot = latest;
+   last_sequence = sequence;
+   return true;
+}
+
+void SharedFrameRing::release()
+{
+   // The latest slot stays protected by LatestSlot, so the announcement can simply be withdrawn.
+   RingHeader->ReaderSlot = RingHeader->SlotNum;
+}
+
+bool SharedFrameRing::waitForFrame(uint64_t last_sequence, int timeout_ms) const
+{
+   const uint32_t notification = RingHeader->Notification;
+   const uint32_t latest = RingHeader->LatestSlot;
+   if (latest < RingHeader->SlotNum && getSlotTable()[latest].Sequence != last_sequence) return true;
+
+   const timespec timeout{ timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+   syscall( SYS_futex, &RingHeader->Notification, FUTEX_WAIT, notification, &timeout, nullptr, 0 );
+   return RingHeader->Notification != notification;
+}
+#else
+bool SharedFrameRing::map(int descriptor, size_t size)
+{
+   return false;
+}
+
+bool SharedFrameRing::create(const std::string& name, int, int, int, int, uint32_t, double)
+{
+   std::cerr << "Shared frame rings are only supported on Linux\n";
+   return false;
+}
+
+bool SharedFrameRing::open(const std::string& name)
+{
+   std::cerr << "Shared frame rings are only supported on Linux\n";
+   return false;
+}
+
+void SharedFrameRing::close() {}
+uint8_t* SharedFrameRing::beginWrite() { return nullptr; }
+void SharedFrameRing::publish(int64_t, double) {}
+bool SharedFrameRing::acquireLatest(uint64_t&) { return false; }
+void SharedFrameRing::release() {}
+bool SharedFrameRing::waitForFrame(uint64_t, int) const { return false; }
+#endif
\ No newline at end of file
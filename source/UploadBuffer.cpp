@@ -0,0 +1,65 @@
+#include "UploadBuffer.h"
+
+UploadBufferGL::UploadBufferGL() :
+   Buffer( 0 ), SlotSize( 0 ), CurrentSlot( -1 ), StallNum( 0 ), MappedData( nullptr )
+{
+}
+
+UploadBufferGL::~UploadBufferGL()
+{
+   deleteBuffer();
+}
+
+void UploadBufferGL::deleteBuffer()
+{
+   for (auto& fence : Fences) {
+      if (fence != nullptr) glDeleteSync( fence );
+   }
+   Fences.clear();
+   if (Buffer != 0) {
+      glUnmapNamedBuffer( Buffer );
+      glDeleteBuffers( 1, &Buffer );
+      Buffer = 0;
+   }
+   MappedData = nullptr;
+   CurrentSlot = -1;
+}
+
+void UploadBufferGL::setBuffer(GLsizeiptr slot_size, int slot_num)
+{
+   deleteBuffer();
+
+   SlotSize = slot_size;
+   Fences.resize( slot_num, nullptr );
+   const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+   glCreateBuffers( 1, &Buffer );
+   glNamedBufferStorage( Buffer, SlotSize * slot_num, nullptr, flags );
+   MappedData = static_cast<uint8_t*>(glMapNamedBufferRange( Buffer, 0, SlotSize * slot_num, flags ));
+}
+
+uint8_t* UploadBufferGL::acquireSlot()
+{
+   if (MappedData == nullptr) return nullptr;
+
+   CurrentSlot = (CurrentSlot + 1) % static_cast<int>(Fences.size());
+   GLsync& fence = Fences[CurrentSlot];
+   if (fence != nullptr) {
+      // The slot is only written again after the GPU has consumed the uploads that were issued from it.
+      GLenum result = glClientWaitSync( fence, 0, 0 );
+      if (result == GL_TIMEOUT_EXPIRED) {
+         StallNum++;
+         do {
+            result = glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+         } while (result == GL_TIMEOUT_EXPIRED);
+      }
+      glDeleteSync( fence );
+      fence = nullptr;
+   }
+   return MappedData + getCurrentOffset();
+}
+
+void UploadBufferGL::releaseSlot()
+{
+   if (CurrentSlot < 0) return;
+   Fences[CurrentSlot] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
@@ -0,0 +1,505 @@
+#include "VideoCube.h"
+
+VideoCube::VideoCube() :
+   VisibilityMargin( 1.2f ), MinDecodeHeadroom( 1.25 ), RenditionSwitchInterval( 1000.0 ),
+   SeekRefineDelay( 150.0 ), TileNum( 0 ), Rendition( 0 ), LastRenditionSwitchTime( 0.0 ), PendingRendition( -1 ),
+   RenditionOpened( false ), CommittedIndex( 0 ), SeekIndex( -1 ), PendingSeekMode( SeekMode::Exact ), SeekPreviewShown( false ), ResidentTileMasks{}
+{
+}
+
+VideoCube::~VideoCube()
+{
+   stopRenditionOpener();
+}
+
+void VideoCube::setSourceSettings(const VideoSource::Settings& settings)
+{
+   SourceSettings = settings;
+   if (SourceSettings.Format == VideoSource::PixelFormat::NV12 &&
+       !VideoSource::decodesToNV12( SourceSettings.Decoder )) {
+      std::cerr << "Only FFmpeg decodes the videos to NV12, so they are decoded to BGR\n";
+      SourceSettings.Format = VideoSource::PixelFormat::BGR;
+   }
+}
+
+bool VideoCube::openStream(const std::string& video_path, const StreamRegion& region, cv::Mat& first_frame)
+{
+   Streams.emplace_back( std::make_unique<VideoStream>() );
+   Regions.emplace_back( region );
+   return Streams.back()->open( video_path, first_frame, SourceSettings );
+}
+
+void VideoCube::resetPlaybackState()
+{
+   DueIndices.resize( Streams.size() );
+   Visible.assign( Streams.size(), true );
+   Synced.assign( Streams.size(), true );
+   ResidentTileMasks.fill( 0 );
+   CommittedIndex = 0;
+   SeekIndex = -1;
+   Drift = DriftStatistics();
+}
+
+bool VideoCube::openStreams(const std::vector<std::string>& video_paths, std::vector<cv::Mat>& first_frames)
+{
+   Streams.clear();
+   Regions.clear();
+   SourceSettings.CacheShareNum = static_cast<int>(video_paths.size());
+   first_frames.resize( video_paths.size() );
+   for (size_t i = 0; i < video_paths.size(); ++i) {
+      if (!openStream( video_paths[i], StreamRegion(static_cast<int>(i), -1, -1), first_frames[i] )) return false;
+   }
+   return true;
+}
+
+bool VideoCube::open(const std::vector<std::string>& video_paths, std::vector<cv::Mat>& first_frames)
+{
+   stopRenditionOpener();
+   TileNum = 0;
+   RenditionPathSets.clear();
+   RenditionWidths.clear();
+   if (!openStreams( video_paths, first_frames )) return false;
+   resetPlaybackState();
+   return true;
+}
+
+bool VideoCube::openAtlas(const std::string& video_path, std::vector<cv::Mat>& first_frames)
+{
+   // The source settings resample the single video into a cube atlas, which is always visible.
+   if (SourceSettings.InputProjection == VideoSource::Projection::Cube) {
+      std::cerr << "A single video needs a projection that covers the whole cube\n";
+      return false;
+   }
+
+   stopRenditionOpener();
+   TileNum = 0;
+   RenditionPathSets.clear();
+   RenditionWidths.clear();
+   Streams.clear();
+   Regions.clear();
+   SourceSettings.CacheShareNum = 1;
+   first_frames.resize( 1 );
+   if (!openStream( video_path, StreamRegion(-1, -1, -1), first_frames[0] )) return false;
+   resetPlaybackState();
+   return true;
+}
+
+bool VideoCube::openRenditions(
+   const std::vector<std::vector<std::string>>& rendition_path_sets,
+   std::vector<cv::Mat>& first_frames
+)
+{
+   // The renditions are six-face sets of the same content, ordered from the smallest to the largest.
+   // Playback starts with the smallest one and moves up as the view and the decode headroom allow.
+   if (rendition_path_sets.empty()) return false;
+
+   stopRenditionOpener();
+
+   // The widths are read by the sources the streams decode with, so a cached or an FFmpeg rendition is not probed
+   // by another demuxer.
+   RenditionWidths.clear();
+   for (const auto& path_set : rendition_path_sets) {
+      const std::unique_ptr<VideoSource> probe = VideoSource::create( SourceSettings );
+      if (!probe->open( path_set[0], SourceSettings.Format )) {
+         std::cerr << "Could not open the rendition " << path_set[0].c_str() << "\n";
+         return false;
+      }
+      RenditionWidths.emplace_back( probe->getFrameSize().width );
+   }
+
+   TileNum = 0;
+   Rendition = 0;
+   LastRenditionSwitchTime = 0.0;
+   RenditionPathSets = rendition_path_sets;
+   if (!openStreams( RenditionPathSets[Rendition], first_frames )) return false;
+   resetPlaybackState();
+   return true;
+}
+
+double VideoCube::getDecodeHeadroom() const
+{
+   // How many times over a frame interval the slowest visible decoder could decode its frame.
+   double slowest_decode_time = 0.0;
+   double frame_duration = 0.0;
+   for (int i = 0; i < getStreamNum(); ++i) {
+      if (!Visible[i]) continue;
+      slowest_decode_time = std::max( slowest_decode_time, Streams[i]->getAverageDecodeTime() );
+      frame_duration = Streams[i]->getFrameDuration();
+   }
+   if (slowest_decode_time <= 0.0) return std::numeric_limits<double>::max();
+   return frame_duration / slowest_decode_time;
+}
+
+VideoCube::StreamStatistics VideoCube::getStreamStatistics() const
+{
+   StreamStatistics statistics;
+   for (const auto& stream : Streams) {
+      statistics.Stages += stream->getStageTimes();
+      statistics.CompressTime += stream->getCompressTime();
+      statistics.DroppedFrameNum += stream->getDroppedFrameNum();
+      statistics.SkippedFrameNum += stream->getSkippedFrameNum();
+      statistics.ResyncNum += stream->getResyncNum();
+   }
+   return statistics;
+}
+
+int VideoCube::selectRendition(float fov, int viewport_height) const
+{
+   // A face spans [-1, 1] in tangent space, so it covers height / tan(fov / 2) pixels on the screen.
+   const float half_fov_tangent = std::tan( glm::radians( fov ) * 0.5f );
+   const float required_width = static_cast<float>(viewport_height) / std::max( half_fov_tangent, 1e-3f );
+   int desired = getRenditionNum() - 1;
+   for (int i = 0; i < getRenditionNum(); ++i) {
+      if (static_cast<float>(RenditionWidths[i]) >= required_width) {
+         desired = i;
+         break;
+      }
+   }
+
+   // The next rendition has about four times the pixels, so it is only chosen if decoding it would still keep up.
+   const double headroom = getDecodeHeadroom();
+   if (desired > Rendition) {
+      const double scale = static_cast<double>(RenditionWidths[Rendition + 1]) / RenditionWidths[Rendition];
+      desired = headroom >= MinDecodeHeadroom * scale * scale ? Rendition + 1 : Rendition;
+   }
+   if (headroom < MinDecodeHeadroom && Rendition > 0) desired = std::min( desired, Rendition - 1 );
+   return desired;
+}
+
+void VideoCube::openPendingRendition()
+{
+   std::vector<std::unique_ptr<VideoStream>> streams;
+   std::vector<cv::Mat> first_frames(RenditionPathSets[PendingRendition].size());
+   for (size_t i = 0; i < first_frames.size(); ++i) {
+      streams.emplace_back( std::make_unique<VideoStream>() );
+      if (!streams.back()->open( RenditionPathSets[PendingRendition][i], first_frames[i], SourceSettings )) {
+         streams.clear();
+         break;
+      }
+   }
+   PendingStreams = std::move( streams );
+   PendingFirstFrames = std::move( first_frames );
+   RenditionOpened = true;
+}
+
+void VideoCube::stopRenditionOpener()
+{
+   if (RenditionOpener.joinable()) RenditionOpener.join();
+   PendingRendition = -1;
+   PendingStreams.clear();
+   PendingFirstFrames.clear();
+}
+
+bool VideoCube::updateRendition(float fov, int viewport_height, std::vector<cv::Mat>& first_frames)
+{
+   if (PendingRendition < 0) {
+      if (getRenditionNum() < 2) return false;
+      if (Clock.getTime() - LastRenditionSwitchTime < RenditionSwitchInterval) return false;
+
+      const int desired = selectRendition( fov, viewport_height );
+      if (desired == Rendition) return false;
+
+      PendingRendition = desired;
+      RenditionOpened = false;
+      RenditionOpener = std::thread( &VideoCube::openPendingRendition, this );
+      return false;
+   }
+   if (!RenditionOpened) return false;
+
+   // A rendition that could not be opened leaves the current streams playing.
+   RenditionOpener.join();
+   const int opened = PendingRendition;
+   PendingRendition = -1;
+   LastRenditionSwitchTime = Clock.getTime();
+   if (PendingStreams.empty()) {
+      std::cerr << "Could not switch to the rendition " << opened << ", so it is removed from the ladder\n";
+      RenditionPathSets.erase( RenditionPathSets.begin() + opened );
+      RenditionWidths.erase( RenditionWidths.begin() + opened );
+      if (opened < Rendition) Rendition--;
+      PendingFirstFrames.clear();
+      return false;
+   }
+
+   // The new streams resync to the running clock, and join the committed sets once they have caught up.
+   Rendition = opened;
+   Streams = std::move( PendingStreams );
+   PendingStreams.clear();
+   first_frames = std::move( PendingFirstFrames );
+   PendingFirstFrames.clear();
+   Regions.clear();
+   for (int i = 0; i < getStreamNum(); ++i) Regions.emplace_back( i, -1, -1 );
+   Visible.assign( Streams.size(), true );
+   Synced.assign( Streams.size(), false );
+   for (const auto& stream : Streams) stream->play( &Clock );
+   return true;
+}
+
+bool VideoCube::openTiled(
+   const std::vector<std::string>& face_directory_paths,
+   int tile_num,
+   std::vector<cv::Mat>& first_frames
+)
+{
+   // Each face directory has a low-resolution base.avi covering the whole face, and tile_<row>_<column>.avi
+   // for every tile of the tile_num x tile_num grid. The tiles of a face must have the same size.
+   // The resident tiles of a face are passed to the shader as the bits of a uint, so the grid is at most 5 x 5.
+   if (tile_num < 1 || tile_num > 5) {
+      std::cerr << "The number of tiles per side should be between 1 and 5\n";
+      return false;
+   }
+
+   stopRenditionOpener();
+   Streams.clear();
+   Regions.clear();
+   TileNum = tile_num;
+   const auto face_num = static_cast<int>(face_directory_paths.size());
+   SourceSettings.CacheShareNum = face_num * (1 + tile_num * tile_num);
+   first_frames.resize( SourceSettings.CacheShareNum );
+   for (int i = 0; i < face_num; ++i) {
+      if (!openStream( face_directory_paths[i] + "/base.avi", StreamRegion(i, -1, -1), first_frames[i] )) return false;
+   }
+   for (int i = 0; i < face_num; ++i) {
+      for (int r = 0; r < tile_num; ++r) {
+         for (int c = 0; c < tile_num; ++c) {
+            const int stream = getStreamNum();
+            const std::string tile_path =
+               face_directory_paths[i] + "/tile_" + std::to_string( r ) + "_" + std::to_string( c ) + ".avi";
+            if (!openStream( tile_path, StreamRegion(i, r, c), first_frames[stream] )) return false;
+         }
+      }
+   }
+   resetPlaybackState();
+   return true;
+}
+
+void VideoCube::play(bool stepped)
+{
+   // A stepped clock never runs, so no frame is skipped as overdue before stepTo is first called.
+   if (stepped && !Streams.empty()) Clock.pause( 0.5 * getFrameDuration() );
+   else Clock.start();
+   for (const auto& stream : Streams) stream->play( &Clock );
+}
+
+void VideoCube::seek(double time, SeekMode mode)
+{
+   if (Streams.empty()) return;
+
+   // Without keyframes a keyframe seek would land on the target itself, and be refined for nothing.
+   if (mode == SeekMode::Keyframe && !hasKeyframes()) mode = SeekMode::Exact;
+
+   // The clock holds in the middle of the target frame until every stream has it, so that the set is not
+   // skipped as overdue while the streams decode up to it.
+   const double frame_duration = Streams[0]->getFrameDuration();
+   const auto index = static_cast<int64_t>(std::max( time, 0.0 ) / frame_duration);
+   Clock.pause( (static_cast<double>(index) + 0.5) * frame_duration );
+   for (const auto& stream : Streams) stream->seek( index, mode == SeekMode::Keyframe );
+   CommittedIndex = index - 1;
+   SeekIndex = index;
+   PendingSeekMode = mode;
+   SeekPreviewShown = false;
+   LastSeekTime = std::chrono::steady_clock::now();
+}
+
+void VideoCube::stepTo(int64_t index)
+{
+   if (Streams.empty()) return;
+
+   // The decoders keep filling their rings ahead of the held frame, so the next set is usually ready when asked.
+   Clock.pause( (static_cast<double>(index) + 0.5) * getFrameDuration() );
+}
+
+bool VideoCube::hasEnded()
+{
+   // No complete set follows once a stream has nothing left to decode or to take.
+   return std::any_of(
+      Participants.begin(), Participants.end(),
+      [this](int stream) { return Streams[stream]->isEndOfStream() && Streams[stream]->getOldestFrameIndex() < 0; }
+   );
+}
+
+bool VideoCube::hasKeyframes() const
+{
+   return !Streams.empty() &&
+      std::all_of( Streams.begin(), Streams.end(), [](const auto& stream) { return stream->hasKeyframes(); } );
+}
+
+void VideoCube::updateSeek(int64_t committed_index)
+{
+   if (SeekIndex < 0) return;
+
+   if (committed_index == SeekIndex) {
+      if (PendingSeekMode == SeekMode::Keyframe) SeekPreviewShown = true;
+      else {
+         SeekIndex = -1;
+         Clock.resume();
+      }
+      return;
+   }
+
+   const std::chrono::duration<double, std::milli> idle_time = std::chrono::steady_clock::now() - LastSeekTime;
+   if (SeekPreviewShown && idle_time.count() > SeekRefineDelay) seek( Clock.getTime(), SeekMode::Exact );
+}
+
+glm::vec2 VideoCube::getRegionMin(const StreamRegion& region) const
+{
+   if (!region.isTile()) return glm::vec2(0.0f);
+   return glm::vec2(region.Column, region.Row) / static_cast<float>(TileNum);
+}
+
+glm::vec2 VideoCube::getRegionMax(const StreamRegion& region) const
+{
+   if (!region.isTile()) return glm::vec2(1.0f);
+   return glm::vec2(region.Column + 1, region.Row + 1) / static_cast<float>(TileNum);
+}
+
+bool VideoCube::isRegionInFrustum(
+   const glm::mat4& view_projection,
+   float half_length,
+   const StreamRegion& region
+) const
+{
+   if (region.isAtlas()) return true;
+
+   const glm::vec2 st_min = getRegionMin( region );
+   const glm::vec2 st_max = getRegionMax( region );
+   const std::array<glm::vec2, 4> corner_st{
+      glm::vec2(st_min.x, st_min.y), glm::vec2(st_max.x, st_min.y),
+      glm::vec2(st_max.x, st_max.y), glm::vec2(st_min.x, st_max.y)
+   };
+   std::array<glm::vec4, 4> corners{};
+   for (int i = 0; i < 4; ++i) {
+      const glm::vec3 position = half_length * CubeFaceRemap::getCubeMapDirection( region.Face, corner_st[i] );
+      corners[i] = view_projection * glm::vec4(position, 1.0f);
+   }
+
+   // The region is culled only when all of its corners are outside of the same clip plane.
+   for (int k = 0; k < 3; ++k) {
+      const float scale = k < 2 ? VisibilityMargin : 1.0f;
+      const bool outside_negative = std::all_of(
+         corners.begin(), corners.end(), [k, scale](const glm::vec4& p) { return p[k] < -scale * p.w; }
+      );
+      const bool outside_positive = std::all_of(
+         corners.begin(), corners.end(), [k, scale](const glm::vec4& p) { return p[k] > scale * p.w; }
+      );
+      if (outside_negative || outside_positive) return false;
+   }
+   return true;
+}
+
+void VideoCube::updateVisibility(const glm::mat4& view_projection, float half_length)
+{
+   for (int i = 0; i < getStreamNum(); ++i) {
+      const bool visible = isRegionInFrustum( view_projection, half_length, Regions[i] );
+      if (visible == Visible[i]) continue;
+
+      // A hidden stream stops decoding, and it joins the committed sets again once it has caught up with them.
+      Visible[i] = visible;
+      if (visible) Synced[i] = false;
+      Streams[i]->setPaused( !visible );
+   }
+}
+
+void VideoCube::updateParticipants()
+{
+   Participants.clear();
+   for (int i = 0; i < getStreamNum(); ++i) {
+      if (!Visible[i]) continue;
+      if (!Synced[i]) {
+         Streams[i]->dropFramesBefore( CommittedIndex + 1 );
+         Synced[i] = Streams[i]->getOldestFrameIndex() > CommittedIndex || Streams[i]->isEndOfStream();
+      }
+      if (Synced[i]) Participants.emplace_back( i );
+   }
+}
+
+void VideoCube::updateDrift()
+{
+   int64_t most_advanced = std::numeric_limits<int64_t>::min();
+   int64_t least_advanced = std::numeric_limits<int64_t>::max();
+   for (const auto& i : Participants) {
+      const int64_t index = Streams[i]->getDecodedFrameIndex();
+      most_advanced = std::max( most_advanced, index );
+      least_advanced = std::min( least_advanced, index );
+   }
+   Drift.CurrentDrift = most_advanced - least_advanced;
+   Drift.MaxDrift = std::max( Drift.MaxDrift, Drift.CurrentDrift );
+}
+
+int64_t VideoCube::findCompleteIndex() const
+{
+   // The newest due index that every stream has ready, or -1 if the due frames do not form a complete set.
+   const std::vector<int64_t>& reference = DueIndices[Participants[0]];
+   for (auto it = reference.rbegin(); it != reference.rend(); ++it) {
+      if (*it <= CommittedIndex) break;
+
+      const bool complete = std::all_of(
+         Participants.begin() + 1, Participants.end(),
+         [this, it](int stream) {
+            const std::vector<int64_t>& indices = DueIndices[stream];
+            return std::find( indices.begin(), indices.end(), *it ) != indices.end();
+         }
+      );
+      if (complete) return *it;
+   }
+   return -1;
+}
+
+void VideoCube::discardIncompleteFrames()
+{
+   // A frame older than the oldest ready frame of another stream can never be part of a complete set.
+   // Dropping it frees the ring slot so that the decoder of that stream can catch up.
+   int64_t first_possible_index = -1;
+   for (const auto& i : Participants) {
+      first_possible_index = std::max( first_possible_index, Streams[i]->getOldestFrameIndex() );
+   }
+   for (const auto& i : Participants) {
+      const int dropped_num = Streams[i]->getDroppedFrameNum();
+      Streams[i]->dropFramesBefore( first_possible_index );
+      Drift.DiscardedFrameNum += Streams[i]->getDroppedFrameNum() - dropped_num;
+   }
+}
+
+void VideoCube::updateResidentTileMasks(const std::vector<bool>& updated)
+{
+   // Only the tiles of the committed index are sampled. The others are covered by the base layer.
+   ResidentTileMasks.fill( 0 );
+   for (int i = 0; i < getStreamNum(); ++i) {
+      if (!Regions[i].isTile() || !updated[i]) continue;
+      ResidentTileMasks[Regions[i].Face] |= 1u << (Regions[i].Row * TileNum + Regions[i].Column);
+   }
+}
+
+bool VideoCube::commitFrames(std::vector<VideoStream::Frame>& frames, std::vector<bool>& updated)
+{
+   updateSeek( -1 );
+   updateParticipants();
+   if (Participants.empty()) return false;
+
+   updateDrift();
+   const double time = Clock.getTime();
+   bool has_new_due_frame = false;
+   for (const auto& i : Participants) {
+      Streams[i]->getDueFrameIndices( DueIndices[i], time );
+      if (!DueIndices[i].empty() && DueIndices[i].back() > CommittedIndex) has_new_due_frame = true;
+   }
+   if (!has_new_due_frame) return false;
+
+   const int64_t index = findCompleteIndex();
+   if (index < 0) {
+      Drift.HeldSetNum++;
+      discardIncompleteFrames();
+      return false;
+   }
+
+   // Every stream has the frame ready, and only this thread removes frames, so none of these takes can fail.
+   frames.resize( Streams.size() );
+   updated.assign( Streams.size(), false );
+   for (const auto& i : Participants) {
+      updated[i] = Streams[i]->takeFrame( frames[i], index );
+   }
+   CommittedIndex = index;
+   Drift.CommittedSetNum++;
+   updateResidentTileMasks( updated );
+   updateSeek( index );
+   return true;
+}
@@ -0,0 +1,59 @@
+#include "OpenCVVideoSource.h"
+#include "CachedVideoSource.h"
+#include "CubeAtlasVideoSource.h"
+#ifdef USE_FFMPEG
+#include "FFmpegVideoSource.h"
+#endif
+
+std::unique_ptr<VideoSource> VideoSource::create(const Settings& settings)
+{
+   std::unique_ptr<VideoSource> decoder;
+#ifdef USE_FFMPEG
+   if (settings.Decoder == Backend::FFmpeg) decoder = std::make_unique<FFmpegVideoSource>();
+#else
+   if (settings.Decoder == Backend::FFmpeg) {
+      std::cerr << "FFmpeg support is not built in, so OpenCV decodes the videos\n";
+   }
+#endif
+   if (decoder == nullptr) decoder = std::make_unique<OpenCVVideoSource>();
+   if (!settings.CacheDirectory.empty()) {
+      decoder = std::make_unique<CachedVideoSource>(
+         std::move( decoder ), settings.CacheDirectory, settings.CacheSizeLimit,
+         std::max( settings.CacheShareNum, 1 )
+      );
+   }
+   if (settings.InputProjection == Projection::Cube) return decoder;
+
+   // The decoded frames are cached before resampling, so a cached video follows changes of the calibration.
+   return std::make_unique<CubeAtlasVideoSource>( std::move( decoder ), settings );
+}
+
+#ifdef USE_FFMPEG
+bool VideoSource::decodesToNV12(Backend backend)
+{
+   return backend == Backend::FFmpeg;
+}
+#else
+bool VideoSource::decodesToNV12(Backend /*backend*/)
+{
+   return false;
+}
+#endif
+
+void VideoSource::addStageTime(Stage stage, const std::chrono::steady_clock::time_point& start)
+{
+   StageTicks[static_cast<int>(stage)] += (std::chrono::steady_clock::now() - start).count();
+}
+
+VideoSource::StageTimes VideoSource::getStageTimes() const
+{
+   const auto to_ms = [](int64_t ticks) {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::duration(ticks)).count();
+   };
+   StageTimes times;
+   times.Demux = to_ms( StageTicks[static_cast<int>(Stage::Demux)] );
+   times.Decode = to_ms( StageTicks[static_cast<int>(Stage::Decode)] );
+   times.Convert = to_ms( StageTicks[static_cast<int>(Stage::Convert)] );
+   times.FrameNum = FrameNum;
+   return times;
+}
\ No newline at end of file
@@ -0,0 +1,333 @@
+#include "VideoStream.h"
+
+VideoStream::VideoStream(int ring_size) :
+   RingSize( std::max( ring_size, 2 ) ), ResyncThreshold( 500.0 ), Tail( 0 ), ReadyFrameNum( 0 ), DroppedFrameNum( 0 ),
+   SkippedFrameNum( 0 ), ResyncNum( 0 ), NextFrameIndex( 0 ), DecodedFrameIndex( -1 ), FrameDuration( 1000.0 / 30.0 ),
+   Format( PixelFormat::BGR ), Compression( BlockFormat::None ), AverageDecodeTime( 0.0 ), CompressTicks( 0 ),
+   StopDecoding( false ), EndOfStream( false ), Paused( false ), FullFrameRequired( true ), Held( false ),
+   SeekToKeyframe( false ), SeekIndex( -1 ), Generation( 0 ), Ring( RingSize ), Clock( nullptr )
+{
+}
+
+VideoStream::~VideoStream()
+{
+   close();
+}
+
+bool VideoStream::open(
+   const std::string& video_path,
+   cv::Mat& first_frame,
+   const VideoSource::Settings& settings
+)
+{
+   close();
+   Source = VideoSource::create( settings );
+   if (!Source->open( video_path, settings.Format )) {
+      std::cerr << "Could not open video file " << video_path.c_str() << "\n";
+      return false;
+   }
+
+   Format = settings.Format;
+   PictureSize = Source->getFrameSize();
+   if (Format == PixelFormat::NV12 && (PictureSize.width % 2 != 0 || PictureSize.height % 2 != 0)) {
+      std::cerr << "NV12 frames need an even width and height, but " << video_path.c_str() << " is "
+         << PictureSize.width << "x" << PictureSize.height << "\n";
+      Source->close();
+      return false;
+   }
+
+   const double fps = Source->getFPS();
+   FrameDuration = fps > 0.0 ? 1000.0 / fps : 1000.0 / 30.0;
+   NextFrameIndex = 0;
+   DecodedFrameIndex = -1;
+
+   Frame frame;
+   if (!readFrame( frame )) {
+      std::cerr << "Could not read the first frame of " << video_path.c_str() << "\n";
+      Source->close();
+      return false;
+   }
+   cv::swap( first_frame, frame.Image );
+   PictureSize = getPictureSize( first_frame, Format );
+   Compression = getCompression( PictureSize, Format, settings.Compression );
+   if (!Keyframes.load( video_path )) {
+      std::vector<int64_t> keyframes;
+      if (Source->getKeyframes( keyframes )) {
+         Keyframes.set( std::move( keyframes ) );
+         Keyframes.save( video_path );
+      }
+   }
+
+   // The first frame is uploaded as a whole, so the first decoded one is too.
+   PreviousImage.release();
+   PassedDirtyBlocks.clear();
+   FullFrameRequired = true;
+   Tail = 0;
+   ReadyFrameNum = 0;
+   DroppedFrameNum = 0;
+   SkippedFrameNum = 0;
+   ResyncNum = 0;
+   AverageDecodeTime = 0.0;
+   CompressTicks = 0;
+   StopDecoding = false;
+   EndOfStream = false;
+   Paused = false;
+   Held = false;
+   SeekIndex = -1;
+   return true;
+}
+
+void VideoStream::play(const PlaybackClock* clock)
+{
+   if (Source == nullptr || !Source->isOpened() || Decoder.joinable()) return;
+
+   Clock = clock;
+   Decoder = std::thread( &VideoStream::decode, this );
+}
+
+void VideoStream::close()
+{
+   {
+      std::lock_guard<std::mutex> lock( RingMutex );
+      StopDecoding = true;
+   }
+   SlotFreed.notify_all();
+   if (Decoder.joinable()) Decoder.join();
+   if (Source != nullptr) Source->close();
+}
+
+void VideoStream::setPaused(bool paused)
+{
+   if (Paused == paused) return;
+
+   {
+      std::lock_guard<std::mutex> lock( RingMutex );
+      Paused = paused;
+      if (!paused) {
+         // The frames decoded before pausing are stale by now.
+         DroppedFrameNum += ReadyFrameNum;
+         popFrames( ReadyFrameNum );
+      }
+   }
+   SlotFreed.notify_one();
+}
+
+void VideoStream::seek(int64_t index, bool keyframe_only)
+{
+   {
+      std::lock_guard<std::mutex> lock( RingMutex );
+      DroppedFrameNum += ReadyFrameNum;
+      popFrames( ReadyFrameNum );
+      SeekIndex = std::max( index, static_cast<int64_t>(0) );
+      SeekToKeyframe = keyframe_only;
+      Held = false;
+      EndOfStream = false;
+      Generation++;
+   }
+   SlotFreed.notify_one();
+}
+
+void VideoStream::resync()
+{
+   // A stream resumed after the clock jumped backward is ahead of it, and one resumed after a long pause is behind.
+   const double time = Clock->getTime();
+   if (std::abs( time - getNextTimestamp() ) <= ResyncThreshold) return;
+
+   // The source is put on the keyframe before the due frame, and the overdue frames after it are skipped.
+   const auto due_index = static_cast<int64_t>(time / FrameDuration);
+   const int64_t keyframe = Keyframes.findKeyframe( due_index );
+   if (Source->seek( keyframe )) {
+      NextFrameIndex = keyframe;
+      DecodedFrameIndex = keyframe - 1;
+      FullFrameRequired = true;
+      ResyncNum++;
+   }
+}
+
+bool VideoStream::seekFrame(Frame& frame, int64_t index, bool keyframe_only)
+{
+   // Only the keyframe is converted. The frames between it and the target are decoded and dropped.
+   const int64_t keyframe = Keyframes.findKeyframe( index );
+   if (!Source->seek( keyframe )) return false;
+
+   NextFrameIndex = keyframe;
+   if (!keyframe_only) {
+      for (; NextFrameIndex < index; ++NextFrameIndex) {
+         if (!Source->skip()) return false;
+      }
+   }
+   if (!readFrame( frame )) return false;
+
+   // While scrubbing, the keyframe stands in for the target until the target itself is decoded.
+   frame.Index = index;
+   frame.Timestamp = static_cast<double>(index) * FrameDuration;
+   DecodedFrameIndex = index;
+   FullFrameRequired = true;
+   return true;
+}
+
+bool VideoStream::readFrame(Frame& frame)
+{
+   const double estimated_timestamp = getNextTimestamp();
+   if (!Source->read( frame.Image ) || frame.Image.empty()) return false;
+
+   // The timestamps of the source are not reliable for every container,
+   // so the frame index is used when it does not move forward.
+   const double timestamp = Source->getTimestamp();
+   frame.Timestamp = timestamp > 0.0 || NextFrameIndex == 0 ? timestamp : estimated_timestamp;
+   frame.Index = NextFrameIndex++;
+   DecodedFrameIndex = frame.Index;
+   return true;
+}
+
+void VideoStream::finishStream(uint64_t generation)
+{
+   // The decoder waits for a seek at the end of the stream. A seek requested meanwhile has already reset it.
+   std::lock_guard<std::mutex> lock( RingMutex );
+   if (generation == Generation) EndOfStream = true;
+}
+
+void VideoStream::decode()
+{
+   while (true) {
+      int slot;
+      int64_t seek_index;
+      bool seek_to_keyframe;
+      uint64_t generation;
+      {
+         std::unique_lock<std::mutex> lock( RingMutex );
+         SlotFreed.wait(
+            lock, [this]() { return StopDecoding || (!Paused && !Held && !EndOfStream && ReadyFrameNum < RingSize); }
+         );
+         if (StopDecoding) return;
+         slot = (Tail + ReadyFrameNum) % RingSize;
+         seek_index = SeekIndex;
+         seek_to_keyframe = SeekToKeyframe;
+         generation = Generation;
+         SeekIndex = -1;
+      }
+
+      if (seek_index < 0) {
+         resync();
+
+         // A frame whose display interval has already passed is only demuxed and decoded, not converted or queued.
+         if (getNextTimestamp() + FrameDuration < Clock->getTime()) {
+            if (!Source->skip()) {
+               finishStream( generation );
+               continue;
+            }
+            DecodedFrameIndex = NextFrameIndex++;
+            SkippedFrameNum++;
+            continue;
+         }
+      }
+
+      // The slot after the ready frames is never handed out to the consumer, so it is filled without the lock.
+      const auto start = std::chrono::steady_clock::now();
+      const bool decoded =
+         seek_index < 0 ? readFrame( Ring[slot] ) : seekFrame( Ring[slot], seek_index, seek_to_keyframe );
+      if (!decoded) {
+         finishStream( generation );
+         continue;
+      }
+      updateDirtyBlocks( Ring[slot] );
+
+      // Compressing the frame here keeps it off the render loop, and counts it in the decode time of the stream.
+      if (Compression != BlockFormat::None) {
+         const auto compress_start = std::chrono::steady_clock::now();
+         BlockCompressor::compress( Ring[slot].Image, Compression, Ring[slot].Blocks );
+         CompressTicks += (std::chrono::steady_clock::now() - compress_start).count();
+      }
+      const std::chrono::duration<double, std::milli> decode_time = std::chrono::steady_clock::now() - start;
+      const double average = AverageDecodeTime;
+      AverageDecodeTime = average == 0.0 ? decode_time.count() : 0.9 * average + 0.1 * decode_time.count();
+
+      // A frame decoded while a seek was requested belongs to the position before the seek.
+      std::lock_guard<std::mutex> lock( RingMutex );
+      if (generation != Generation) continue;
+      if (seek_index >= 0 && seek_to_keyframe) Held = true;
+      ReadyFrameNum++;
+   }
+}
+
+void VideoStream::updateDirtyBlocks(Frame& frame)
+{
+   // The previous frame is diffed where it is, in the ring or with the consumer, which only reads it. Its buffer is
+   // only decoded into again once a later frame has been decoded, or right after a seek, which is a full frame.
+   if (FullFrameRequired || PreviousImage.empty() || PreviousImage.data == frame.Image.data) {
+      FrameDelta::markAllBlocksDirty( frame.DirtyBlocks, PictureSize );
+      FullFrameRequired = false;
+   }
+   else if (Format == PixelFormat::NV12) {
+      FrameDelta::findDirtyBlocksNV12( frame.DirtyBlocks, frame.Image, PreviousImage, PictureSize );
+   }
+   else FrameDelta::findDirtyBlocks( frame.DirtyBlocks, frame.Image, PreviousImage );
+   PreviousImage = frame.Image;
+}
+
+void VideoStream::popFrames(int frame_num)
+{
+   // The changes of the dropped frames are carried over to the next taken frame.
+   for (int i = 0; i < frame_num; ++i) {
+      const Frame& frame = Ring[(Tail + i) % RingSize];
+      if (PassedDirtyBlocks.empty()) PassedDirtyBlocks = frame.DirtyBlocks;
+      else FrameDelta::mergeDirtyBlocks( PassedDirtyBlocks, frame.DirtyBlocks );
+   }
+   Tail = (Tail + frame_num) % RingSize;
+   ReadyFrameNum -= frame_num;
+}
+
+void VideoStream::getDueFrameIndices(std::vector<int64_t>& indices, double time)
+{
+   indices.clear();
+   std::lock_guard<std::mutex> lock( RingMutex );
+   for (int i = 0; i < ReadyFrameNum; ++i) {
+      const Frame& frame = Ring[(Tail + i) % RingSize];
+      if (frame.Timestamp > time) break;
+      indices.emplace_back( frame.Index );
+   }
+}
+
+bool VideoStream::takeFrame(Frame& frame, int64_t index)
+{
+   {
+      std::lock_guard<std::mutex> lock( RingMutex );
+      int position = 0;
+      while (position < ReadyFrameNum && Ring[(Tail + position) % RingSize].Index != index) position++;
+      if (position == ReadyFrameNum) return false;
+
+      DroppedFrameNum += position;
+      popFrames( position + 1 );
+
+      // The buffers of the caller go back to the ring to be reused.
+      Frame& taken = Ring[(Tail + RingSize - 1) % RingSize];
+      cv::swap( frame.Image, taken.Image );
+      cv::swap( frame.Blocks, taken.Blocks );
+      std::swap( frame.DirtyBlocks, PassedDirtyBlocks );
+      PassedDirtyBlocks.clear();
+      frame.Timestamp = taken.Timestamp;
+      frame.Index = taken.Index;
+   }
+   SlotFreed.notify_one();
+   return true;
+}
+
+void VideoStream::dropFramesBefore(int64_t index)
+{
+   {
+      std::lock_guard<std::mutex> lock( RingMutex );
+      int position = 0;
+      while (position < ReadyFrameNum && Ring[(Tail + position) % RingSize].Index < index) position++;
+      if (position == 0) return;
+
+      DroppedFrameNum += position;
+      popFrames( position );
+   }
+   SlotFreed.notify_one();
+}
+
+int64_t VideoStream::getOldestFrameIndex()
+{
+   std::lock_guard<std::mutex> lock( RingMutex );
+   return ReadyFrameNum > 0 ? Ring[Tail].Index : -1;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "BlockCompressor.h"
+
+// Measures the throughput and the quality of the block compression on images, or on the static sample faces.
+//   BlockCompressorBenchmark [repetitions] [image paths...]
+
+static void benchmark(const std::vector<cv::Mat>& images, BlockFormat format, int repetitions)
+{
+   // The first round warms up the threads and the buffers, and is not timed.
+   std::vector<cv::Mat> blocks(images.size());
+   for (size_t i = 0; i < images.size(); ++i) BlockCompressor::compress( images[i], format, blocks[i] );
+
+   const auto start = std::chrono::steady_clock::now();
+   for (int r = 0; r < repetitions; ++r) {
+      for (size_t i = 0; i < images.size(); ++i) BlockCompressor::compress( images[i], format, blocks[i] );
+   }
+   const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+   double pixel_num = 0.0, compressed_bytes = 0.0, psnr = 0.0;
+   cv::Mat decompressed;
+   for (size_t i = 0; i < images.size(); ++i) {
+      BlockCompressor::decompress( blocks[i], format, images[i].size(), decompressed );
+      psnr += cv::PSNR( images[i], decompressed );
+      pixel_num += static_cast<double>(images[i].total());
+      compressed_bytes += static_cast<double>(blocks[i].total());
+   }
+   const double seconds = std::max( elapsed.count(), 1e-9 ) / static_cast<double>(repetitions);
+   std::cout << BlockCompressor::getFormatName( format ) << ": " << std::fixed << std::setprecision( 2 )
+      << pixel_num / seconds * 1e-6 << " Mpixel/s, " << pixel_num * 3.0 / seconds * 1e-9 << " GB/s of BGR input, "
+      << pixel_num * 3.0 / compressed_bytes << ":1 over BGR, " << psnr / static_cast<double>(images.size())
+      << " dB PSNR\n";
+}
+
+int main(int argc, char** argv)
+{
+   const std::vector<std::string> arguments(argv + 1, argv + argc);
+   const int repetitions = arguments.empty() ? 10 : std::max( std::stoi( arguments[0] ), 1 );
+   std::vector<std::string> image_paths;
+   if (arguments.size() > 1) image_paths.assign( arguments.begin() + 1, arguments.end() );
+   if (image_paths.empty()) {
+      const std::string sample_directory_path = std::string(CMAKE_SOURCE_DIR) + "/samples/static/sample1";
+      for (const auto& face : { "right", "left", "top", "bottom", "back", "front" }) {
+         image_paths.emplace_back( sample_directory_path + "/" + face + ".jpg" );
+      }
+   }
+
+   // The images are cropped to multiples of 4, as the video faces would have to be.
+   std::vector<cv::Mat> images;
+   for (const auto& path : image_paths) {
+      const cv::Mat image = cv::imread( path );
+      if (image.empty() || image.cols < 4 || image.rows < 4) {
+         std::cerr << "Could not read an image of at least 4x4 from " << path.c_str() << "\n";
+         return 1;
+      }
+      images.emplace_back( image( cv::Rect(0, 0, image.cols / 4 * 4, image.rows / 4 * 4) ).clone() );
+   }
+   std::cout << "Compressing " << images.size() << " images of " << images[0].cols << "x" << images[0].rows
+      << " " << repetitions << " times on " << cv::getNumThreads() << " threads\n";
+   benchmark( images, BlockFormat::BC1, repetitions );
+   benchmark( images, BlockFormat::BC3, repetitions );
+   benchmark( images, BlockFormat::BC7, repetitions );
+   return 0;
+}
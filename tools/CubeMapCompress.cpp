@@ -0,0 +1,110 @@
+#include "CubeFaceLoader.h"
+#include "CubeMapFile.h"
+#include "CubeMipGenerator.h"
+#include "BlockCompressor.h"
+
+// Compresses the six faces of a cube, with every mip level, into a cube map file that CubeMapping uploads into
+// compressed storage as it is. The faces are right, left, top, bottom, back and front, by default those of the first
+// static sample. The mip levels are averaged across the edges of the faces, and BC3 keeps the alpha of faces that
+// have one.
+//   CubeMapCompress <bc1|bc3|bc7> <output path> [six face image paths]
+
+int main(int argc, char** argv)
+{
+   const std::vector<std::string> arguments(argv + 1, argv + argc);
+   if (arguments.size() < 2 || (arguments.size() != 2 && arguments.size() != 8)) {
+      std::cerr << "Usage: CubeMapCompress <bc1|bc3|bc7> <output path> [six face image paths]\n";
+      return 1;
+   }
+   BlockFormat format = BlockFormat::None;
+   if (arguments[0] == "bc1") format = BlockFormat::BC1;
+   else if (arguments[0] == "bc3") format = BlockFormat::BC3;
+   else if (arguments[0] == "bc7") format = BlockFormat::BC7;
+   if (format == BlockFormat::None) {
+      std::cerr << "Unknown block format " << arguments[0].c_str() << "\n";
+      return 1;
+   }
+   const std::string& output_path = arguments[1];
+   std::vector<std::string> image_paths(arguments.begin() + 2, arguments.end());
+   if (image_paths.empty()) {
+      const std::string sample_directory_path = std::string(CMAKE_SOURCE_DIR) + "/samples/static/sample1";
+      for (const auto& face : { "right", "left", "top", "bottom", "back", "front" }) {
+         image_paths.emplace_back( sample_directory_path + "/" + face + ".jpg" );
+      }
+   }
+
+   const auto start = std::chrono::steady_clock::now();
+   CubeFaceLoader loader;
+   loader.start( image_paths, format == BlockFormat::BC3 ? cv::IMREAD_UNCHANGED : cv::IMREAD_COLOR );
+   std::vector<std::array<cv::Mat, 6>> levels(1);
+   int face;
+   cv::Mat image;
+   while (loader.takeFace( face, image )) {
+      if (image.empty()) continue;
+      if (image.depth() != CV_8U) image.release();
+      else if (image.channels() == 1) cv::cvtColor( image, image, cv::COLOR_GRAY2BGR );
+      if (image.channels() == 3) cv::cvtColor( image, image, cv::COLOR_BGR2BGRA );
+      levels[0][face] = image;
+   }
+   for (int i = 0; i < 6; ++i) {
+      const cv::Mat& first_face = levels[0][0];
+      const cv::Mat& face_image = levels[0][i];
+      if (face_image.empty() || face_image.size() != first_face.size() || face_image.type() != first_face.type()) {
+         std::cerr << "Could not read a face of the cube size from " << image_paths[i].c_str() << "\n";
+         return 1;
+      }
+   }
+   const double load_time = loader.getElapsedTime();
+
+   // The levels whose sizes are not multiples of 4 are padded with their edges, which the texture never samples.
+   const auto compress_start = std::chrono::steady_clock::now();
+   CubeMipGenerator::addMipLevels( levels );
+   std::vector<std::array<cv::Mat, 6>> block_levels(levels.size());
+   double pixel_num = 0.0;
+   for (size_t level = 0; level < levels.size(); ++level) {
+      for (int i = 0; i < 6; ++i) {
+         const cv::Mat& face_image = levels[level][i];
+         cv::Mat padded = face_image;
+         if (!BlockCompressor::isCompressible( face_image.size() )) {
+            cv::copyMakeBorder(
+               face_image, padded, 0, (4 - face_image.rows % 4) % 4, 0, (4 - face_image.cols % 4) % 4,
+               cv::BORDER_REPLICATE
+            );
+         }
+         BlockCompressor::compress( padded, format, block_levels[level][i] );
+         pixel_num += static_cast<double>(padded.total());
+      }
+   }
+   const std::chrono::duration<double, std::milli> compress_time = std::chrono::steady_clock::now() - compress_start;
+
+   const GLenum internal_format = BlockCompressor::getInternalFormat( format );
+   if (!CubeMapFile::write(
+         output_path, CubeMapFile::getContentHash( image_paths ), internal_format, 0, 0, block_levels
+      )) {
+      std::cerr << "Could not write the cube map to " << output_path.c_str() << "\n";
+      return 1;
+   }
+   const std::chrono::duration<double, std::milli> total_time = std::chrono::steady_clock::now() - start;
+
+   // The quality is measured on the first level, in BGR.
+   double compressed_bytes = 0.0, psnr = 0.0;
+   for (const auto& level : block_levels) {
+      for (const auto& blocks : level) compressed_bytes += static_cast<double>(blocks.total());
+   }
+   cv::Mat decompressed, original;
+   for (int i = 0; i < 6; ++i) {
+      BlockCompressor::decompress( block_levels[0][i], format, levels[0][i].size(), decompressed );
+      if (levels[0][i].channels() == 4) cv::cvtColor( levels[0][i], original, cv::COLOR_BGRA2BGR );
+      else original = levels[0][i];
+      psnr += cv::PSNR( original, decompressed ) / 6.0;
+   }
+   std::cout << std::fixed << std::setprecision( 2 ) << "Compressed 6 faces of " << levels[0][0].cols << "x"
+      << levels[0][0].rows << " with " << levels.size() << " levels to " << BlockCompressor::getFormatName( format )
+      << " on " << cv::getNumThreads() << " threads\n"
+      << " - loading: " << load_time << " ms, compressing: " << compress_time.count() << " ms ("
+      << pixel_num / (compress_time.count() * 1e3) << " Mpixel/s), total: " << total_time.count() << " ms\n"
+      << " - " << compressed_bytes / (1 << 20) << " MiB, " << pixel_num * 4.0 / compressed_bytes
+      << ":1 over RGBA8, " << psnr << " dB PSNR\n"
+      << "Written to " << output_path.c_str() << "\n";
+   return 0;
+}
@@ -0,0 +1,120 @@
+#include "SharedFrameRing.h"
+#include <csignal>
+
+// Publishes synthetic cube faces to a shared frame ring until interrupted, or watches the frames of another one.
+//   SharedFrameProducer [name] [width] [height] [fps] [bgr|nv12]
+//   SharedFrameProducer --watch [name]
+
+static std::atomic<bool> Interrupted( false );
+
+static void fillFace(uint8_t* face, int width, int height, uint32_t pixel_format, int face_index, int64_t frame)
+{
+   // Each face has its own color with a bar that moves across it, so dropped or torn frames are easy to see.
+   const int bar = static_cast<int>(frame * 4 % width);
+   const auto shade = static_cast<uint8_t>(40 + face_index * 36);
+   if (pixel_format == 1) {
+      for (int y = 0; y < height; ++y) {
+         uint8_t* row = face + static_cast<size_t>(y) * width;
+         std::memset( row, shade, width );
+         std::memset( row + std::max( bar - 8, 0 ), 235, std::min( bar, 8 ) );
+      }
+      uint8_t* chroma = face + static_cast<size_t>(width) * height;
+      for (int i = 0; i < width * height / 2; i += 2) {
+         chroma[i] = static_cast<uint8_t>(64 + face_index * 24);
+         chroma[i + 1] = static_cast<uint8_t>(192 - face_index * 24);
+      }
+   }
+   else {
+      for (int y = 0; y < height; ++y) {
+         uint8_t* row = face + static_cast<size_t>(y) * width * 3;
+         for (int x = 0; x < width; ++x) {
+            const bool on_bar = x >= bar - 8 && x < bar;
+            row[x * 3] = on_bar ? 255 : static_cast<uint8_t>(face_index % 2 == 0 ? shade : 0);
+            row[x * 3 + 1] = on_bar ? 255 : static_cast<uint8_t>(face_index / 2 == 1 ? shade : 0);
+            row[x * 3 + 2] = on_bar ? 255 : static_cast<uint8_t>(face_index / 2 != 1 ? shade : 0);
+         }
+      }
+   }
+}
+
+static int produce(const std::string& name, int width, int height, double fps, uint32_t pixel_format)
+{
+   SharedFrameRing ring;
+   if (!ring.create( name, 6, 3, width, height, pixel_format, fps )) {
+      std::cerr << "Could not create the shared frame ring " << name.c_str() << "\n";
+      return 1;
+   }
+   std::cout << "Publishing " << width << "x" << height << (pixel_format == 1 ? " NV12" : " BGR")
+      << " faces at " << fps << " fps to " << name.c_str() << "\n";
+
+   const auto start = std::chrono::steady_clock::now();
+   const auto period = std::chrono::duration<double>(1.0 / fps);
+   const uint64_t face_stride = ring.getHeader().FaceStride;
+   for (int64_t frame = 0; !Interrupted; ++frame) {
+      uint8_t* slot = ring.beginWrite();
+      for (int i = 0; i < 6; ++i) fillFace( slot + i * face_stride, width, height, pixel_format, i, frame );
+      const auto now = std::chrono::steady_clock::now();
+      ring.publish( frame, std::chrono::duration<double, std::milli>(now - start).count() );
+      std::this_thread::sleep_until(
+         start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * (frame + 1))
+      );
+   }
+   return 0;
+}
+
+static int watch(const std::string& name)
+{
+   SharedFrameRing ring;
+   if (!ring.open( name )) return 1;
+
+   const SharedFrameRing::Header& header = ring.getHeader();
+   std::cout << "Watching " << header.Width << "x" << header.Height << (header.PixelFormat == 1 ? " NV12" : " BGR")
+      << " faces of " << name.c_str() << "\n";
+
+   // Frames published while the watcher is away are replaced in the mailbox, so they are counted as dropped.
+   uint64_t sequence = UINT64_MAX;
+   int64_t last_index = -1, received_num = 0, dropped_num = 0;
+   auto report_time = std::chrono::steady_clock::now();
+   while (!Interrupted) {
+      if (!ring.waitForFrame( sequence, 500 )) continue;
+      if (!ring.acquireLatest( sequence )) continue;
+
+      const int64_t index = ring.getHeldSlot().FrameIndex;
+      ring.release();
+      if (last_index >= 0 && index > last_index + 1) dropped_num += index - last_index - 1;
+      last_index = index;
+      received_num++;
+
+      const auto now = std::chrono::steady_clock::now();
+      const double elapsed = std::chrono::duration<double>(now - report_time).count();
+      if (elapsed >= 1.0) {
+         std::cout << "Frame " << index << ": " << static_cast<double>(received_num) / elapsed
+            << " fps, dropped frames: " << dropped_num << "\n";
+         received_num = 0;
+         report_time = now;
+      }
+   }
+   return 0;
+}
+
+int main(int argc, char** argv)
+{
+   std::signal( SIGINT, [](int) { Interrupted = true; } );
+   std::signal( SIGTERM, [](int) { Interrupted = true; } );
+
+   const std::vector<std::string> arguments(argv + 1, argv + argc);
+   if (!arguments.empty() && arguments[0] == "--watch") {
+      return watch( arguments.size() > 1 ? arguments[1] : "/CubeMapping" );
+   }
+
+   const std::string name = arguments.size() > 0 ? arguments[0] : "/CubeMapping";
+   const int width = arguments.size() > 1 ? std::stoi( arguments[1] ) : 512;
+   const int height = arguments.size() > 2 ? std::stoi( arguments[2] ) : 512;
+   const double fps = arguments.size() > 3 ? std::stod( arguments[3] ) : 30.0;
+   const uint32_t pixel_format = arguments.size() > 4 && arguments[4] == "nv12" ? 1 : 0;
+   if (pixel_format == 1 && (width % 2 != 0 || height % 2 != 0)) {
+      std::cerr << "NV12 faces need an even width and height\n";
+      return 1;
+   }
+   return produce( name, width, height, fps, pixel_format );
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "Object.h"
+#include "PooledMatAllocator.h"
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Plays six face videos in a hidden window for a while, looping them, and writes the sustained frame rate, the jitter
+// of the frame intervals, the time of each pipeline stage, the dropped frames and the growth of the resident memory
+// as JSON. The videos are right, left, top, bottom, back and front.avi of the directory, by default the dynamic
+// samples.
+//   VideoSoakBenchmark [seconds] [json path] [video directory] [--nv12] [--ffmpeg] [--bc1|--bc7]
+
+struct Sample
+{
+   double Time; // s
+   int64_t ResidentBytes;
+   int64_t CommittedSetNum;
+   double FPS;  // since the previous sample
+};
+
+static int64_t getResidentBytes()
+{
+#ifdef __linux__
+   std::ifstream statm("/proc/self/statm");
+   int64_t size = 0, resident = 0;
+   if (statm >> size >> resident) return resident * static_cast<int64_t>(sysconf( _SC_PAGESIZE ));
+#endif
+   return 0;
+}
+
+static double getPercentile(const std::vector<double>& sorted_values, double percentile)
+{
+   if (sorted_values.empty()) return 0.0;
+   const auto rank = static_cast<size_t>(std::ceil( percentile / 100.0 * static_cast<double>(sorted_values.size()) ));
+   return sorted_values[std::clamp( rank, static_cast<size_t>(1), sorted_values.size() ) - 1];
+}
+
+static void writePercentiles(std::ostream& json, const char* name, std::vector<double> values)
+{
+   std::sort( values.begin(), values.end() );
+   double sum = 0.0;
+   for (const auto& value : values) sum += value;
+   json << "  \"" << name << "\": { \"mean\": " << (values.empty() ? 0.0 : sum / static_cast<double>(values.size()))
+      << ", \"p50\": " << getPercentile( values, 50.0 ) << ", \"p90\": " << getPercentile( values, 90.0 )
+      << ", \"p99\": " << getPercentile( values, 99.0 ) << ", \"p99.9\": " << getPercentile( values, 99.9 )
+      << ", \"max\": " << (values.empty() ? 0.0 : values.back()) << " },\n";
+}
+
+static void writeStage(std::ostream& json, const char* name, double total, int64_t frame_num, bool last = false)
+{
+   json << "    \"" << name << "\": { \"total_ms\": " << total << ", \"per_frame_ms\": "
+      << (frame_num > 0 ? total / static_cast<double>(frame_num) : 0.0) << " }" << (last ? "\n" : ",\n");
+}
+
+int main(int argc, char** argv)
+{
+   VideoSource::Settings settings;
+   std::vector<std::string> arguments;
+   for (int i = 1; i < argc; ++i) {
+      const std::string argument = argv[i];
+      if (argument == "--nv12") settings.Format = VideoSource::PixelFormat::NV12;
+      else if (argument == "--ffmpeg") settings.Decoder = VideoSource::Backend::FFmpeg;
+      else if (argument == "--bc1") settings.Compression = BlockFormat::BC1;
+      else if (argument == "--bc7") settings.Compression = BlockFormat::BC7;
+      else arguments.emplace_back( argument );
+   }
+   const double duration = arguments.size() > 0 ? std::max( std::stod( arguments[0] ), 1.0 ) : 60.0;
+   const std::string json_path = arguments.size() > 1 ? arguments[1] : "video_soak.json";
+   const std::string video_directory =
+      arguments.size() > 2 ? arguments[2] : std::string(CMAKE_SOURCE_DIR) + "/samples/dynamic";
+
+   if (!glfwInit()) {
+      std::cerr << "Cannot Initialize OpenGL...\n";
+      return 1;
+   }
+   glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 4 );
+   glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 6 );
+   glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+   glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+   GLFWwindow* window = glfwCreateWindow( 64, 64, "Video Soak Benchmark", nullptr, nullptr );
+   if (window == nullptr) {
+      std::cerr << "Could not create an OpenGL context\n";
+      glfwTerminate();
+      return 1;
+   }
+   glfwMakeContextCurrent( window );
+   if (!gladLoadGLLoader( (GLADloadproc)glfwGetProcAddress )) {
+      std::cerr << "Failed to initialize GLAD\n";
+      glfwTerminate();
+      return 1;
+   }
+   cv::Mat::setDefaultAllocator( PooledMatAllocator::getInstance() );
+
+   // Nothing is drawn, so the corners are enough to size the cube. The camera looks at the cube from outside,
+   // so that every face stays in the frustum and keeps decoding.
+   const float length = 5.0f;
+   std::vector<glm::vec3> corners;
+   for (int i = 0; i < 8; ++i) {
+      corners.emplace_back( (i & 1) ? length : -length, (i & 2) ? length : -length, (i & 4) ? length : -length );
+   }
+   CameraGL camera(glm::vec3(0.0f, 0.0f, -8.0f * length), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+   camera.updateWindowSize( 1920, 1080 );
+   const int64_t initial_resident_bytes = getResidentBytes();
+   auto cube = std::make_unique<ObjectGL>();
+   std::vector<std::string> video_paths;
+   for (const auto& face : { "right", "left", "top", "bottom", "back", "front" }) {
+      video_paths.emplace_back( video_directory + "/" + face + ".avi" );
+   }
+   cube->setVideoObject( GL_TRIANGLES, corners, video_paths, settings );
+   const VideoCube* video = cube->getVideo();
+   if (video == nullptr) {
+      std::cerr << "Could not open the videos of " << video_directory.c_str() << "\n";
+      cube.reset();
+      glfwTerminate();
+      return 1;
+   }
+   std::cout << "Playing " << video_directory.c_str() << " for " << duration << " s\n";
+
+   // The intervals are measured between the commits of consecutive sets, so the ones across a loop are left out.
+   const double frame_duration = video->getFrameDuration();
+   const double sample_period = std::clamp( duration / 100.0, 1.0, 60.0 );
+   const auto start = std::chrono::steady_clock::now();
+   std::chrono::steady_clock::time_point last_commit_time;
+   int64_t last_index = video->getCommittedIndex();
+   bool interval_started = false;
+   int64_t committed_set_num = 0, skipped_index_num = 0, loop_num = 0, peak_resident_bytes = 0;
+   std::vector<double> intervals, jitters;
+   std::vector<Sample> samples;
+   double elapsed = 0.0;
+   while (elapsed < duration) {
+      cube->updateVideoCubeTextures( &camera );
+      glFlush();
+
+      const auto now = std::chrono::steady_clock::now();
+      const int64_t index = video->getCommittedIndex();
+      if (index != last_index) {
+         if (interval_started) {
+            const std::chrono::duration<double, std::milli> interval = now - last_commit_time;
+            intervals.emplace_back( interval.count() );
+            jitters.emplace_back( std::abs( interval.count() - frame_duration ) );
+            skipped_index_num += std::max( index - last_index - 1, static_cast<int64_t>(0) );
+         }
+         last_commit_time = now;
+         last_index = index;
+         interval_started = true;
+         committed_set_num++;
+      }
+      if (cube->hasVideoEnded()) {
+         cube->seekVideo( 0.0, VideoCube::SeekMode::Exact );
+         last_index = video->getCommittedIndex();
+         interval_started = false;
+         loop_num++;
+      }
+
+      elapsed = std::chrono::duration<double>(now - start).count();
+      if (elapsed >= static_cast<double>(samples.size() + 1) * sample_period) {
+         const int64_t previous_set_num = samples.empty() ? 0 : samples.back().CommittedSetNum;
+         const double previous_time = samples.empty() ? 0.0 : samples.back().Time;
+         const int64_t resident_bytes = getResidentBytes();
+         peak_resident_bytes = std::max( peak_resident_bytes, resident_bytes );
+         samples.push_back(
+            {
+               elapsed, resident_bytes, committed_set_num,
+               static_cast<double>(committed_set_num - previous_set_num) / (elapsed - previous_time)
+            }
+         );
+      }
+      glfwPollEvents();
+      std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+   }
+
+   // The memory is compared with the first sample, after the rings, the pools and the caches have filled up.
+   const VideoCube::StreamStatistics streams = video->getStreamStatistics();
+   const VideoCube::DriftStatistics& drift = video->getDriftStatistics();
+   const ObjectGL::UploadStatistics& upload = cube->getVideoUploadStatistics();
+   const PooledMatAllocator::Statistics pool = PooledMatAllocator::getInstance()->getStatistics();
+   const int64_t final_resident_bytes = getResidentBytes();
+   const int64_t baseline_resident_bytes = samples.empty() ? initial_resident_bytes : samples.front().ResidentBytes;
+   std::ofstream json(json_path);
+   json << std::fixed << std::setprecision( 3 ) << "{\n";
+   json << "  \"duration_s\": " << elapsed << ",\n";
+   json << "  \"frame_duration_ms\": " << frame_duration << ",\n";
+   json << "  \"streams\": " << video->getStreamNum() << ",\n";
+   const bool nv12 = video->getPixelFormat() == VideoSource::PixelFormat::NV12;
+   json << "  \"pixel_format\": \"" << (nv12 ? "nv12" : "bgr") << "\",\n";
+   json << "  \"loops\": " << loop_num << ",\n";
+   json << "  \"frames\": { \"committed_sets\": " << committed_set_num << ", \"sustained_fps\": "
+      << static_cast<double>(committed_set_num) / elapsed << ", \"skipped_indices\": " << skipped_index_num
+      << ", \"held_sets\": " << drift.HeldSetNum << ", \"discarded_frames\": " << drift.DiscardedFrameNum
+      << ", \"dropped_frames\": " << streams.DroppedFrameNum << ", \"overdue_frames\": " << streams.SkippedFrameNum
+      << ", \"resyncs\": " << streams.ResyncNum << ", \"max_drift\": " << drift.MaxDrift << " },\n";
+   writePercentiles( json, "interval_ms", intervals );
+   writePercentiles( json, "jitter_ms", jitters );
+   json << "  \"stages\": {\n";
+   writeStage( json, "demux", streams.Stages.Demux, streams.Stages.FrameNum );
+   writeStage( json, "decode", streams.Stages.Decode, streams.Stages.FrameNum );
+   writeStage( json, "convert", streams.Stages.Convert, streams.Stages.FrameNum );
+   writeStage( json, "compress", streams.CompressTime, streams.Stages.FrameNum );
+   writeStage( json, "upload", upload.UploadTime, committed_set_num, true );
+   json << "  },\n";
+   json << "  \"upload\": { \"uploaded_bytes\": " << upload.UploadedBytes << ", \"saved_bytes\": "
+      << upload.SavedBytes << ", \"unchanged_frames\": " << upload.SkippedUploadNum << " },\n";
+   json << "  \"memory\": { \"initial_rss_bytes\": " << initial_resident_bytes << ", \"baseline_rss_bytes\": "
+      << baseline_resident_bytes << ", \"final_rss_bytes\": " << final_resident_bytes << ", \"peak_rss_bytes\": "
+      << std::max( peak_resident_bytes, final_resident_bytes ) << ", \"rss_growth_bytes\": "
+      << final_resident_bytes - baseline_resident_bytes << ", \"pool_used_bytes\": " << pool.UsedBytes
+      << ", \"pool_pooled_bytes\": " << pool.PooledBytes << " },\n";
+   json << "  \"samples\": [";
+   for (size_t i = 0; i < samples.size(); ++i) {
+      json << (i == 0 ? "\n" : ",\n") << "    { \"time_s\": " << samples[i].Time << ", \"rss_bytes\": "
+         << samples[i].ResidentBytes << ", \"committed_sets\": " << samples[i].CommittedSetNum << ", \"fps\": "
+         << samples[i].FPS << " }";
+   }
+   json << "\n  ]\n}\n";
+   std::cout << "Sustained " << static_cast<double>(committed_set_num) / elapsed << " fps over " << elapsed
+      << " s, written to " << json_path.c_str() << "\n";
+
+   cube.reset();
+   glfwDestroyWindow( window );
+   glfwTerminate();
+   return json ? 0 : 1;
+}